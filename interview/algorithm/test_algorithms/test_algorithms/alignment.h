@@ -0,0 +1,153 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "string_edit_distance.h"
+
+// Alignment cost policies. A policy gives Substitute(a, b) (0 for a match) and gap
+// costs where a gap of length L costs GapOpen() + L * GapExtend(); kAffine is false
+// when GapOpen() is always 0. Aligner<Policy> calls them directly, so compile-time
+// constants fold into the inner loop.
+
+// substitution = Mismatch, gap of length L = L * Gap
+template <int Mismatch, int Gap>
+struct LinearCost
+{
+	static const bool kAffine = false;
+	int Substitute(unsigned char a, unsigned char b) const { return a == b ? 0 : Mismatch; }
+	int GapOpen() const { return 0; }
+	int GapExtend() const { return Gap; }
+};
+
+// the unit costs of cost_match and cost_indel
+typedef LinearCost<1, 1> UnitCost;
+
+// substitution = Mismatch, gap of length L = Open + L * Extend (Gotoh)
+template <int Mismatch, int Open, int Extend>
+struct AffineCost
+{
+	static const bool kAffine = true;
+	int Substitute(unsigned char a, unsigned char b) const { return a == b ? 0 : Mismatch; }
+	int GapOpen() const { return Open; }
+	int GapExtend() const { return Extend; }
+};
+
+// substitution matrix over bytes with affine gaps, filled at run time
+struct MatrixCost
+{
+	static const bool kAffine = true;
+	std::vector<int> m_sub;		// m_sub[a * 256 + b]
+	int m_open;
+	int m_extend;
+
+	MatrixCost(int mismatch, int open, int extend) : m_sub(256 * 256, mismatch), m_open(open), m_extend(extend)
+	{
+		for (int c = 0; c < 256; c++)
+			m_sub[c * 256 + c] = 0;
+	}
+
+	void SetSubstitute(unsigned char a, unsigned char b, int cost)
+	{
+		m_sub[a * 256 + b] = cost;
+		m_sub[b * 256 + a] = cost;
+	}
+
+	int Substitute(unsigned char a, unsigned char b) const { return m_sub[a * 256 + b]; }
+	int GapOpen() const { return m_open; }
+	int GapExtend() const { return m_extend; }
+};
+
+// Minimum alignment cost of s against t under Cost, in O(nt) memory. Linear gap
+// policies run the plain edit distance recurrence, affine ones Gotoh's three-state
+// recurrence. Buffers are kept between calls: reuse one instance per thread.
+template <typename Cost>
+struct Aligner
+{
+	Cost m_cost;
+	std::vector<int> m_row;		// D, best cost ending anywhere
+	std::vector<int> m_gapS;	// X, best cost ending in a gap in t (s[i - 1] deleted)
+
+	Aligner(const Cost& cost = Cost()) : m_cost(cost) {}
+
+	int Compute(const char* s, int ns, const char* t, int nt)
+	{
+		return Cost::kAffine ? ComputeAffine(s, ns, t, nt) : ComputeLinear(s, ns, t, nt);
+	}
+
+private:
+	int ComputeLinear(const char* s, int ns, const char* t, int nt)
+	{
+		const int gap = m_cost.GapExtend();
+		m_row.resize(nt + 1);
+		int* row = m_row.data();
+		for (int j = 0; j <= nt; j++)
+			row[j] = j * gap;
+
+		for (int i = 1; i <= ns; i++)
+		{
+			const unsigned char a = (unsigned char)s[i - 1];
+			int diag = row[0];
+			row[0] = i * gap;
+			for (int j = 1; j <= nt; j++)
+			{
+				const int up = row[j];
+				row[j] = std::min(diag + m_cost.Substitute(a, (unsigned char)t[j - 1]), std::min(up, row[j - 1]) + gap);
+				diag = up;
+			}
+		}
+		return row[nt];
+	}
+
+	int ComputeAffine(const char* s, int ns, const char* t, int nt)
+	{
+		const int open = m_cost.GapOpen();
+		const int extend = m_cost.GapExtend();
+		const int inf = 0x3FFFFFFF;
+
+		m_row.resize(nt + 1);
+		m_gapS.resize(nt + 1);
+		int* row = m_row.data();
+		int* gapS = m_gapS.data();
+		row[0] = 0;
+		gapS[0] = inf;
+		for (int j = 1; j <= nt; j++)
+		{
+			row[j] = open + j * extend;
+			gapS[j] = inf;
+		}
+
+		for (int i = 1; i <= ns; i++)
+		{
+			const unsigned char a = (unsigned char)s[i - 1];
+			int diag = row[0];
+			row[0] = open + i * extend;
+			int gapT = inf;		// Y, best cost ending in a gap in s (t[j - 1] inserted)
+			for (int j = 1; j <= nt; j++)
+			{
+				const int up = row[j];
+				gapS[j] = std::min(up + open, gapS[j]) + extend;
+				gapT = std::min(row[j - 1] + open, gapT) + extend;
+				row[j] = std::min(diag + m_cost.Substitute(a, (unsigned char)t[j - 1]), std::min(gapS[j], gapT));
+				diag = up;
+			}
+		}
+		return row[nt];
+	}
+};
+
+// When a substitution costs the same as a one-character gap, the cost is that
+// constant times the Levenshtein distance, which the bit-parallel engine computes
+// 64 cells per word operation.
+template <int C>
+struct Aligner<LinearCost<C, C>>
+{
+	BitParallelEditDistance m_bp;
+
+	Aligner(const LinearCost<C, C>& = LinearCost<C, C>()) {}
+
+	int Compute(const char* s, int ns, const char* t, int nt)
+	{
+		return C * m_bp.Compute(s, ns, t, nt);
+	}
+};
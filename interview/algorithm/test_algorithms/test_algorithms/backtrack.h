@@ -0,0 +1,146 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+#include "parallel.h"
+
+// The backtrack / is_a_solution / construct_candidates / process_solution skeleton
+// of the generate_* samples as one template. The pieces are policy types resolved at
+// compile time, so every call inlines into the search:
+//
+//   Candidates  typedef Value;  enum { kMaxCandidates = N };
+//               int MaxDepth() const;
+//               bool IsSolution(const Value a[], int k) const;
+//               int Construct(const Value a[], int k, Value c[]) const;
+//   Prune       bool operator()(const Value a[], int k) const, false cuts the
+//               subtree under the partial solution a[0, k)
+//   Visitor     bool operator()(const Value a[], int k), called per solution;
+//               false stops the search
+
+// Stops a search from outside, or from one worker for all of them.
+struct CancelToken
+{
+	std::atomic<bool> m_cancelled;
+
+	CancelToken() : m_cancelled(false) {}
+	void Cancel() { m_cancelled.store(true, std::memory_order_relaxed); }
+	bool IsCancelled() const { return m_cancelled.load(std::memory_order_relaxed); }
+};
+
+struct NoPrune
+{
+	template <typename Value>
+	bool operator()(const Value*, int) const { return true; }
+};
+
+template <typename Candidates, typename Prune, typename Visitor>
+struct Backtracker
+{
+	typedef typename Candidates::Value Value;
+
+	const Candidates& m_candidates;
+	const Prune& m_prune;
+	Visitor& m_visitor;
+	const CancelToken* m_token;
+
+	Backtracker(const Candidates& candidates, const Prune& prune, Visitor& visitor, const CancelToken* token)
+		: m_candidates(candidates), m_prune(prune), m_visitor(visitor), m_token(token)
+	{
+	}
+
+	// searches below the partial solution a[0, k); false once the search was stopped
+	bool Search(Value a[], int k)
+	{
+		if (m_token && m_token->IsCancelled())
+			return false;
+
+		if (m_candidates.IsSolution(a, k))
+			return m_visitor(a, k);
+
+		Value c[Candidates::kMaxCandidates];
+		const int ncandidates = m_candidates.Construct(a, k, c);
+		for (int i = 0; i < ncandidates; i++)
+		{
+			a[k] = c[i];
+			if (!m_prune(a, k + 1))
+				continue;
+			if (!Search(a, k + 1))
+				return false;
+		}
+		return true;
+	}
+};
+
+// Serial search from the empty solution. Returns false if it was stopped.
+template <typename Candidates, typename Prune, typename Visitor>
+bool backtrack_search(const Candidates& candidates, const Prune& prune, Visitor& visitor, const CancelToken* token = nullptr)
+{
+	std::vector<typename Candidates::Value> a(candidates.MaxDepth() + 1);
+	Backtracker<Candidates, Prune, Visitor> search(candidates, prune, visitor, token);
+	return search.Search(a.data(), 0);
+}
+
+template <typename Candidates, typename Prune>
+void backtrack_collect_prefixes(const Candidates& candidates, const Prune& prune,
+	typename Candidates::Value a[], int k, int splitDepth,
+	std::vector<typename Candidates::Value>* prefixes, std::vector<int>* lengths)
+{
+	if (k == splitDepth || candidates.IsSolution(a, k))
+	{
+		prefixes->insert(prefixes->end(), a, a + k);
+		prefixes->resize(lengths->size() * splitDepth + splitDepth);
+		lengths->push_back(k);
+		return;
+	}
+
+	typename Candidates::Value c[Candidates::kMaxCandidates];
+	const int ncandidates = candidates.Construct(a, k, c);
+	for (int i = 0; i < ncandidates; i++)
+	{
+		a[k] = c[i];
+		if (prune(a, k + 1))
+			backtrack_collect_prefixes(candidates, prune, a, k + 1, splitDepth, prefixes, lengths);
+	}
+}
+
+// Parallel search: the tree is expanded serially down to splitDepth, and every
+// subtree below that is a task for parallel_for. There should be many more subtrees
+// than threads, so a worker that finishes early keeps taking the next one and uneven
+// subtrees balance out. visitors holds one visitor per worker (its size is the
+// thread count), so they need no locking; merge them afterwards. A visitor returning
+// false cancels the token and every worker stops at its next node. Returns false if
+// the search was stopped.
+template <typename Candidates, typename Prune, typename Visitor>
+bool backtrack_parallel(const Candidates& candidates, const Prune& prune, std::vector<Visitor>* visitors,
+	int splitDepth, CancelToken* token = nullptr)
+{
+	typedef typename Candidates::Value Value;
+
+	CancelToken localToken;
+	if (!token)
+		token = &localToken;
+
+	std::vector<Value> a(candidates.MaxDepth() + 1);
+	std::vector<Value> prefixes;
+	std::vector<int> lengths;
+	backtrack_collect_prefixes(candidates, prune, a.data(), 0, splitDepth, &prefixes, &lengths);
+
+	const int numThreads = (int)visitors->size();
+	std::vector<std::vector<Value>> scratch(numThreads, std::vector<Value>(candidates.MaxDepth() + 1));
+	parallel_for((int)lengths.size(), numThreads, [&](int task, int worker)
+	{
+		if (token->IsCancelled())
+			return;
+
+		Value* w = scratch[worker].data();
+		const Value* prefix = prefixes.data() + (size_t)task * splitDepth;
+		for (int i = 0; i < lengths[task]; i++)
+			w[i] = prefix[i];
+
+		Backtracker<Candidates, Prune, Visitor> search(candidates, prune, (*visitors)[worker], token);
+		if (!search.Search(w, lengths[task]))
+			token->Cancel();
+	});
+	return !token->IsCancelled();
+}
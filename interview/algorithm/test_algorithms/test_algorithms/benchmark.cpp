@@ -0,0 +1,423 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <io.h>
+#include <process.h>
+#define bench_getpid _getpid
+#define bench_dup _dup
+#define bench_dup2 _dup2
+#define bench_close _close
+#define bench_open _open
+#define bench_fileno _fileno
+#define BENCH_WRONLY _O_WRONLY
+static const char* kNullDevice = "NUL";
+#else
+#include <unistd.h>
+#define bench_getpid getpid
+#define bench_dup dup
+#define bench_dup2 dup2
+#define bench_close close
+#define bench_open open
+#define bench_fileno fileno
+#define BENCH_WRONLY O_WRONLY
+static const char* kNullDevice = "/dev/null";
+#endif
+
+#include "benchmark.h"
+
+static std::vector<BenchInfo>& registry()
+{
+	// function-local so registration order across files doesn't matter
+	static std::vector<BenchInfo> s_benchmarks;
+	return s_benchmarks;
+}
+
+int register_benchmark(const char* name, BenchSetup setup, int default_size, int max_size)
+{
+	BenchInfo info;
+	info.name = name;
+	info.setup = setup;
+	info.default_size = default_size;
+	info.max_size = max_size;
+	registry().push_back(info);
+	return (int)registry().size();
+}
+
+const std::vector<BenchInfo>& get_benchmarks()
+{
+	std::vector<BenchInfo>& benchmarks = registry();
+	std::sort(benchmarks.begin(), benchmarks.end(),
+		[](const BenchInfo& a, const BenchInfo& b) { return strcmp(a.name, b.name) < 0; });
+	return benchmarks;
+}
+
+static volatile long long s_sink = 0;
+static size_t s_peak_bytes = 0;
+
+void bench_consume(long long v)
+{
+	s_sink = s_sink + v;
+}
+
+void bench_report_bytes(size_t bytes)
+{
+	s_peak_bytes = std::max(s_peak_bytes, bytes);
+}
+
+std::string bench_temp_path(const char* name)
+{
+	std::string dir;
+#ifdef _WIN32
+	char buffer[MAX_PATH + 1];
+	const DWORD length = GetTempPathA(sizeof(buffer), buffer);
+	if (length > 0 && length < sizeof(buffer))
+		dir.assign(buffer, length);
+#else
+	const char* tmp = getenv("TMPDIR");
+	dir = tmp && *tmp ? tmp : "/tmp";
+	if (dir[dir.size() - 1] != '/')
+		dir += '/';
+#endif
+	std::ostringstream path;
+	path << dir << "test_algorithms_" << bench_getpid() << "_" << name << ".tmp";
+	return path.str();
+}
+
+std::vector<int> random_ints(int n, int lo, int hi, std::mt19937& rng)
+{
+	std::uniform_int_distribution<int> dist(lo, hi);
+	std::vector<int> v(n);
+	for (int i = 0; i < n; i++)
+		v[i] = dist(rng);
+	return v;
+}
+
+std::vector<int> random_walk(int n, int start, int max_step, std::mt19937& rng)
+{
+	std::uniform_int_distribution<int> dist(-max_step, max_step);
+	std::vector<int> v(n);
+	int x = start;
+	for (int i = 0; i < n; i++)
+	{
+		x = std::max(1, x + dist(rng));
+		v[i] = x;
+	}
+	return v;
+}
+
+std::string random_string(int n, const char* alphabet, std::mt19937& rng)
+{
+	const int nalpha = (int)strlen(alphabet);
+	assert(nalpha > 0);
+	std::uniform_int_distribution<int> dist(0, nalpha - 1);
+	std::string s(n, ' ');
+	for (int i = 0; i < n; i++)
+		s[i] = alphabet[dist(rng)];
+	return s;
+}
+
+std::vector<std::pair<int, int>> random_dag_edges(int num_vertices, int num_edges, std::mt19937& rng)
+{
+	// edges always go forward in a random vertex order, so the graph is acyclic
+	std::vector<int> order(num_vertices);
+	for (int i = 0; i < num_vertices; i++)
+		order[i] = i;
+	std::shuffle(order.begin(), order.end(), rng);
+
+	std::vector<std::pair<int, int>> edges;
+	if (num_vertices < 2)
+		return edges;
+
+	std::uniform_int_distribution<int> dist(0, num_vertices - 1);
+	edges.reserve(num_edges);
+	while ((int)edges.size() < num_edges)
+	{
+		int a = dist(rng);
+		int b = dist(rng);
+		if (a == b)
+			continue;
+		if (a > b)
+			std::swap(a, b);
+		edges.push_back(std::make_pair(order[a], order[b]));
+	}
+	return edges;
+}
+
+// Algorithms in this harness report through printf; benchmarks shouldn't time
+// the terminal, so stdout is pointed at the null device while they run.
+struct StdoutSilencer
+{
+	int saved_fd;
+
+	StdoutSilencer()
+	{
+		fflush(stdout);
+		saved_fd = bench_dup(bench_fileno(stdout));
+		int null_fd = bench_open(kNullDevice, BENCH_WRONLY);
+		if (null_fd >= 0)
+		{
+			bench_dup2(null_fd, bench_fileno(stdout));
+			bench_close(null_fd);
+		}
+	}
+
+	~StdoutSilencer()
+	{
+		fflush(stdout);
+		bench_dup2(saved_fd, bench_fileno(stdout));
+		bench_close(saved_fd);
+	}
+};
+
+struct BenchResult
+{
+	std::string name;
+	int size = 0;
+	int reps = 0;
+	double median_ns = 0.0;
+	double p99_ns = 0.0;
+	double min_ns = 0.0;
+	size_t peak_bytes = 0;	// 0 when the benchmark doesn't report memory
+};
+
+struct BenchOptions
+{
+	int size = 0;			// 0 means each benchmark's default size
+	int warmup = 1;
+	int reps = 10;
+	unsigned int seed = 12345;
+	double threshold = 0.10;	// allowed median slowdown against the baseline
+	std::string json_file;
+	std::string baseline_file;
+	std::vector<std::string> filters;
+};
+
+static double percentile(const std::vector<double>& sorted, double p)
+{
+	// nearest-rank
+	size_t rank = (size_t)std::ceil(p * sorted.size());
+	rank = std::min(std::max(rank, (size_t)1), sorted.size());
+	return sorted[rank - 1];
+}
+
+static BenchResult run_one(const BenchInfo& info, int size, const BenchOptions& opt)
+{
+	std::mt19937 rng(opt.seed);
+	s_peak_bytes = 0;
+
+	std::vector<double> times;
+	times.reserve(opt.reps);
+	{
+		StdoutSilencer silence;
+		BenchBody body = info.setup(size, rng);
+
+		for (int i = 0; i < opt.warmup; i++)
+			body();
+
+		for (int i = 0; i < opt.reps; i++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			body();
+			auto end = std::chrono::steady_clock::now();
+			times.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+		}
+	}
+
+	std::sort(times.begin(), times.end());
+
+	BenchResult res;
+	res.name = info.name;
+	res.size = size;
+	res.reps = opt.reps;
+	res.median_ns = percentile(times, 0.5);
+	res.p99_ns = percentile(times, 0.99);
+	res.min_ns = times.front();
+	res.peak_bytes = s_peak_bytes;
+	return res;
+}
+
+static void write_json(const std::string& filename, const std::vector<BenchResult>& results)
+{
+	std::ofstream out(filename.c_str());
+	if (!out)
+	{
+		fprintf(stderr, "can't write %s\n", filename.c_str());
+		return;
+	}
+
+	// one benchmark per line, which is also what read_baseline() expects
+	out << "{\n  \"benchmarks\": [\n";
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchResult& r = results[i];
+		out << "    {\"name\": \"" << r.name << "\", \"size\": " << r.size << ", \"reps\": " << r.reps
+			<< ", \"median_ns\": " << (long long)r.median_ns << ", \"p99_ns\": " << (long long)r.p99_ns
+			<< ", \"min_ns\": " << (long long)r.min_ns;
+		if (r.peak_bytes > 0)
+			out << ", \"peak_bytes\": " << (unsigned long long)r.peak_bytes;
+		out << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+	}
+	out << "  ]\n}\n";
+}
+
+static bool find_field(const std::string& line, const char* key, std::string* value)
+{
+	std::string pattern = std::string("\"") + key + "\": ";
+	size_t pos = line.find(pattern);
+	if (pos == std::string::npos)
+		return false;
+
+	pos += pattern.size();
+	if (line[pos] == '"')
+	{
+		size_t end = line.find('"', pos + 1);
+		*value = line.substr(pos + 1, end - pos - 1);
+	}
+	else
+	{
+		size_t end = line.find_first_of(",}", pos);
+		*value = line.substr(pos, end - pos);
+	}
+	return true;
+}
+
+// Reads files written by write_json(); keyed by "name/size".
+static std::map<std::string, double> read_baseline(const std::string& filename)
+{
+	std::map<std::string, double> baseline;
+	std::ifstream in(filename.c_str());
+	if (!in)
+	{
+		fprintf(stderr, "can't read baseline %s\n", filename.c_str());
+		return baseline;
+	}
+
+	std::string line;
+	while (std::getline(in, line))
+	{
+		std::string name, size, median;
+		if (find_field(line, "name", &name) && find_field(line, "size", &size) && find_field(line, "median_ns", &median))
+			baseline[name + "/" + size] = atof(median.c_str());
+	}
+	return baseline;
+}
+
+static bool matches(const BenchInfo& info, const std::vector<std::string>& filters)
+{
+	if (filters.empty())
+		return true;
+
+	for (size_t i = 0; i < filters.size(); i++)
+	{
+		if (strstr(info.name, filters[i].c_str()))
+			return true;
+	}
+	return false;
+}
+
+static bool parse_options(int argc, char** argv, BenchOptions* opt)
+{
+	for (int i = 0; i < argc; i++)
+	{
+		const char* arg = argv[i];
+		if (strncmp(arg, "--size=", 7) == 0)
+			opt->size = atoi(arg + 7);
+		else if (strncmp(arg, "--warmup=", 9) == 0)
+			opt->warmup = std::max(0, atoi(arg + 9));
+		else if (strncmp(arg, "--reps=", 7) == 0)
+			opt->reps = std::max(1, atoi(arg + 7));
+		else if (strncmp(arg, "--seed=", 7) == 0)
+			opt->seed = (unsigned int)strtoul(arg + 7, nullptr, 10);
+		else if (strncmp(arg, "--json=", 7) == 0)
+			opt->json_file = arg + 7;
+		else if (strncmp(arg, "--baseline=", 11) == 0)
+			opt->baseline_file = arg + 11;
+		else if (strncmp(arg, "--threshold=", 12) == 0)
+			opt->threshold = atof(arg + 12);
+		else if (strncmp(arg, "--", 2) == 0)
+		{
+			fprintf(stderr, "unknown option %s\n", arg);
+			return false;
+		}
+		else
+			opt->filters.push_back(arg);
+	}
+	return true;
+}
+
+int run_benchmarks(int argc, char** argv)
+{
+	BenchOptions opt;
+	if (!parse_options(argc, argv, &opt))
+		return 2;
+
+	std::map<std::string, double> baseline;
+	if (!opt.baseline_file.empty())
+		baseline = read_baseline(opt.baseline_file);
+
+	printf("%-28s %10s %6s %14s %14s %10s\n", "benchmark", "size", "reps", "median(ms)", "p99(ms)", "vs base");
+
+	std::vector<BenchResult> results;
+	int num_regressions = 0;
+	const std::vector<BenchInfo>& benchmarks = get_benchmarks();
+	for (size_t i = 0; i < benchmarks.size(); i++)
+	{
+		const BenchInfo& info = benchmarks[i];
+		if (!matches(info, opt.filters))
+			continue;
+
+		const int size = opt.size > 0 ? opt.size : info.default_size;
+		if (size > info.max_size)
+		{
+			printf("%-28s %10d   skipped (max size %d)\n", info.name, size, info.max_size);
+			continue;
+		}
+
+		BenchResult res = run_one(info, size, opt);
+		results.push_back(res);
+
+		char delta[32] = "";
+		std::ostringstream key;
+		key << res.name << "/" << res.size;
+		std::map<std::string, double>::const_iterator it = baseline.find(key.str());
+		bool regressed = false;
+		if (it != baseline.end() && it->second > 0.0)
+		{
+			double ratio = res.median_ns / it->second;
+			regressed = ratio > 1.0 + opt.threshold;
+			snprintf(delta, sizeof(delta), "%+.1f%%", (ratio - 1.0) * 100.0);
+		}
+
+		char peak[32] = "";
+		if (res.peak_bytes > 0)
+			snprintf(peak, sizeof(peak), "  peak %.2f MB", res.peak_bytes / (1024.0 * 1024.0));
+
+		printf("%-28s %10d %6d %14.4f %14.4f %10s%s%s\n", res.name.c_str(), res.size, res.reps,
+			res.median_ns * 1e-6, res.p99_ns * 1e-6, delta, peak, regressed ? "  REGRESSION" : "");
+		num_regressions += regressed ? 1 : 0;
+	}
+
+	if (!opt.json_file.empty())
+		write_json(opt.json_file, results);
+
+	if (num_regressions > 0)
+	{
+		printf("%d benchmark(s) slower than baseline by more than %.0f%%\n", num_regressions, opt.threshold * 100.0);
+		return 1;
+	}
+	return 0;
+}
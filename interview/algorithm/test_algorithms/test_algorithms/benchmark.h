@@ -0,0 +1,48 @@
+#pragma once
+
+#include <functional>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+// A benchmark builds its input for a given size once (untimed) and returns the
+// body that the runner then times repeatedly.
+typedef std::function<void()> BenchBody;
+typedef BenchBody (*BenchSetup)(int n, std::mt19937& rng);
+
+struct BenchInfo
+{
+	const char* name;
+	BenchSetup setup;
+	int default_size;
+	int max_size;		// larger sizes are skipped: fixed-size tables or exponential time
+};
+
+int register_benchmark(const char* name, BenchSetup setup, int default_size, int max_size);
+const std::vector<BenchInfo>& get_benchmarks();
+
+// registers at static-init time, one line at the bottom of each algorithm file
+#define REGISTER_BENCHMARK(name, setup, default_size, max_size) \
+	static const int s_bench_##name = register_benchmark(#name, setup, default_size, max_size)
+
+// folds a result into a global so the optimizer can't drop the work
+void bench_consume(long long v);
+
+// optional memory figure for the current benchmark (the largest value reported
+// over its runs), printed next to the timings and written to the json
+void bench_report_bytes(size_t bytes);
+
+// a file name for a benchmark's scratch output in the system temp directory, unique
+// per process and name; the benchmark removes the file itself
+std::string bench_temp_path(const char* name);
+
+// input generators, all deterministic for a given rng state
+std::vector<int> random_ints(int n, int lo, int hi, std::mt19937& rng);
+std::vector<int> random_walk(int n, int start, int max_step, std::mt19937& rng);
+std::string random_string(int n, const char* alphabet, std::mt19937& rng);
+std::vector<std::pair<int, int>> random_dag_edges(int num_vertices, int num_edges, std::mt19937& rng);
+
+// bench [--size=N] [--warmup=N] [--reps=N] [--seed=N] [--json=FILE]
+//       [--baseline=FILE] [--threshold=F] [name...]
+int run_benchmarks(int argc, char** argv);
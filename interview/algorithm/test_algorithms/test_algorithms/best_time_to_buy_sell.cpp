@@ -1,6 +1,17 @@
 #include <stdio.h>
 #include <assert.h>
 
+#include <algorithm>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define MAX_PROFIT_SSE2 1
+#endif
+
+#include "benchmark.h"
+#include "parallel.h"
+
 
 static int solution1(const int* prices, int n)
 {
@@ -37,21 +48,25 @@ struct DpRes
     }
 };
 
-static DpRes DP(const int* prices, int n, int i, int j)
+// memo is n x n, entries with i_buy == -1 not computed yet; every (i, j) is solved
+// once, so O(n^2) time and memory instead of the two-way recursion's O(2^n)
+static DpRes DP(const int* prices, int n, int i, int j, std::vector<DpRes>* memo)
 {
     assert(i >= 0 && i < n);
     assert(j >= 0 && j < n);
 
+    DpRes& cached = (*memo)[(size_t)i * n + j];
+    if (cached.i_buy >= 0)
+        return cached;
+
+    DpRes dpRes;
     if (i == j)
     {
-        DpRes dpRes;
         dpRes.i_buy = i;
         dpRes.i_sell = j;
-        return dpRes;
     }
     else if (i + 1 == j)
     {
-        DpRes dpRes;
         if (prices[i] < prices[j])
         {
             dpRes.i_buy = i;
@@ -63,19 +78,30 @@ static DpRes DP(const int* prices, int n, int i, int j)
             dpRes.i_sell = j;
         }
     }
+    else
+    {
+        const DpRes dp_i_j_minus_1 = DP(prices, n, i, j - 1, memo);
+        DpRes candidate1 = dp_i_j_minus_1;
+        if (prices[j] > prices[dp_i_j_minus_1.i_sell])
+            candidate1.i_sell = j;
 
-    const DpRes dp_i_j_minus_1 = DP(prices, n, i, j - 1);
-    DpRes candidate1 = dp_i_j_minus_1;
-    if (prices[j] > prices[dp_i_j_minus_1.i_sell])
-        candidate1.i_sell = j;
+        const DpRes dp_i_plus_1_j = DP(prices, n, i + 1, j, memo);
+        DpRes candidate2 = dp_i_plus_1_j;
+        if (prices[i] < prices[dp_i_plus_1_j.i_buy])
+            candidate2.i_buy = i;
 
-    const DpRes dp_i_plus_1_j = DP(prices, n, i + 1, j);
-    DpRes candidate2 = dp_i_plus_1_j;
-    if (prices[i] < prices[dp_i_plus_1_j.i_buy])
-        candidate2.i_buy = i;
+        dpRes = candidate1.GetProfile(prices, n) > candidate2.GetProfile(prices, n) ? candidate1 : candidate2;
+    }
+
+    cached = dpRes;
+    return dpRes;
+}
 
-    const DpRes best = candidate1.GetProfile(prices, n) > candidate2.GetProfile(prices, n) ? candidate1 : candidate2;
-    return best;
+static DpRes DP(const int* prices, int n)
+{
+    DpRes unset = { -1, -1 };
+    std::vector<DpRes> memo((size_t)n * n, unset);
+    return DP(prices, n, 0, n - 1, &memo);
 }
 
 int solution3(const int* prices, int n) {
@@ -90,9 +116,288 @@ int solution3(const int* prices, int n) {
     return maxprofit;
 }
 
+// Summary of a run of prices: lowest and highest price (first occurrence) and the
+// best single trade inside the run. Summaries of adjacent runs combine exactly and
+// associatively, since the best trade across both either stays in one run or buys
+// at the left run's low and sells at the right run's high.
+struct ProfitSummary
+{
+    int minPrice;
+    int maxPrice;
+    long long minIndex;
+    long long maxIndex;
+    int profit;
+    long long buyIndex;
+    long long sellIndex;
+};
+
+static ProfitSummary summarize(const int* prices, long long begin, long long end)
+{
+    assert(begin < end);
+    ProfitSummary s;
+    s.minPrice = s.maxPrice = prices[begin];
+    s.minIndex = s.maxIndex = begin;
+    s.profit = 0;
+    s.buyIndex = s.sellIndex = begin;
+
+    // solution3, remembering where
+    for (long long i = begin + 1; i < end; i++)
+    {
+        const int p = prices[i];
+        if (p < s.minPrice)
+        {
+            s.minPrice = p;
+            s.minIndex = i;
+        }
+        else if (p - s.minPrice > s.profit)
+        {
+            s.profit = p - s.minPrice;
+            s.buyIndex = s.minIndex;
+            s.sellIndex = i;
+        }
+        if (p > s.maxPrice)
+        {
+            s.maxPrice = p;
+            s.maxIndex = i;
+        }
+    }
+    return s;
+}
+
+// left must end where right begins
+static ProfitSummary combine(const ProfitSummary& left, const ProfitSummary& right)
+{
+    ProfitSummary s = left;
+    if (right.profit > s.profit)
+    {
+        s.profit = right.profit;
+        s.buyIndex = right.buyIndex;
+        s.sellIndex = right.sellIndex;
+    }
+    if (right.maxPrice - left.minPrice > s.profit)
+    {
+        s.profit = right.maxPrice - left.minPrice;
+        s.buyIndex = left.minIndex;
+        s.sellIndex = right.maxIndex;
+    }
+    if (right.minPrice < s.minPrice)
+    {
+        s.minPrice = right.minPrice;
+        s.minIndex = right.minIndex;
+    }
+    if (right.maxPrice > s.maxPrice)
+    {
+        s.maxPrice = right.maxPrice;
+        s.maxIndex = right.maxIndex;
+    }
+    return s;
+}
+
+// solution3 with buy/sell indices over a series too long for one core, e.g. a
+// memory-mapped file: chunks are summarized on a thread pool and folded left to
+// right. The count is 64-bit; one chunk is at most kProfitChunk prices.
+static const long long kProfitChunk = 1 << 20;
+
+static ProfitSummary max_profit_parallel(const int* prices, long long n, int numThreads = 0)
+{
+    assert(n > 0);
+    const long long numChunks = (n + kProfitChunk - 1) / kProfitChunk;
+    std::vector<ProfitSummary> chunks((size_t)numChunks);
+    parallel_for((int)numChunks, numThreads, [&](int c, int)
+    {
+        const long long begin = c * kProfitChunk;
+        chunks[c] = summarize(prices, begin, std::min(begin + kProfitChunk, n));
+    });
+
+    ProfitSummary s = chunks[0];
+    for (size_t c = 1; c < chunks.size(); c++)
+        s = combine(s, chunks[c]);
+    return s;
+}
+
+#if MAX_PROFIT_SSE2
+// SSE2 has no 32-bit min/max; compare and select
+static inline __m128i max_epi32(__m128i a, __m128i b)
+{
+    __m128i gt = _mm_cmpgt_epi32(a, b);
+    return _mm_or_si128(_mm_and_si128(gt, a), _mm_andnot_si128(gt, b));
+}
+
+static inline __m128i min_epi32(__m128i a, __m128i b)
+{
+    __m128i lt = _mm_cmplt_epi32(a, b);
+    return _mm_or_si128(_mm_and_si128(lt, a), _mm_andnot_si128(lt, b));
+}
+#endif
+
+// "not holding anything yet" for the buy states; low enough to never win, high
+// enough that adding a price can't overflow
+static const int kNoPosition = -0x3FFFFFFF;
+
+// solution3 for many symbols at once. State is structure-of-arrays, one entry per
+// symbol, so a batch of interleaved ticks (one price per symbol per tick, tick-major)
+// updates four symbols per SSE2 instruction. Update() takes single ticks in any order.
+struct MultiSymbolProfit
+{
+    int m_numSymbols;
+    std::vector<int> m_minPrice;
+    std::vector<int> m_best;
+
+    void Reset(int numSymbols)
+    {
+        m_numSymbols = numSymbols;
+        m_minPrice.assign(numSymbols, 0x7FFFFFFF);
+        m_best.assign(numSymbols, 0);
+    }
+
+    void Update(int symbol, int price)
+    {
+        m_minPrice[symbol] = std::min(m_minPrice[symbol], price);
+        m_best[symbol] = std::max(m_best[symbol], price - m_minPrice[symbol]);
+    }
+
+    // prices is numTicks x m_numSymbols
+    void UpdateBatch(const int* prices, int numTicks)
+    {
+        for (int t = 0; t < numTicks; t++)
+        {
+            const int* row = prices + (size_t)t * m_numSymbols;
+            int s = 0;
+#if MAX_PROFIT_SSE2
+            for (; s + 4 <= m_numSymbols; s += 4)
+            {
+                __m128i p = _mm_loadu_si128((const __m128i*)&row[s]);
+                __m128i lo = min_epi32(_mm_loadu_si128((const __m128i*)&m_minPrice[s]), p);
+                __m128i best = max_epi32(_mm_loadu_si128((const __m128i*)&m_best[s]), _mm_sub_epi32(p, lo));
+                _mm_storeu_si128((__m128i*)&m_minPrice[s], lo);
+                _mm_storeu_si128((__m128i*)&m_best[s], best);
+            }
+#endif
+            for (; s < m_numSymbols; s++)
+                Update(s, row[s]);
+        }
+    }
+
+    int Profit(int symbol) const { return m_best[symbol]; }
+};
+
+// At most k buy/sell pairs per symbol. m_buy[j] / m_sell[j] are the best cash after
+// the (j + 1)-th buy / sell, stored [j * m_numSymbols + symbol], so each of the 2k
+// state rows is contiguous across symbols and vectorizes like MultiSymbolProfit.
+struct MultiSymbolProfitK
+{
+    int m_numSymbols;
+    int m_k;
+    std::vector<int> m_buy;
+    std::vector<int> m_sell;
+
+    void Reset(int numSymbols, int k)
+    {
+        m_numSymbols = numSymbols;
+        m_k = k;
+        m_buy.assign((size_t)k * numSymbols, kNoPosition);
+        m_sell.assign((size_t)k * numSymbols, 0);
+    }
+
+    void Update(int symbol, int price)
+    {
+        int prevSell = 0;
+        for (int j = 0; j < m_k; j++)
+        {
+            int& buy = m_buy[(size_t)j * m_numSymbols + symbol];
+            int& sell = m_sell[(size_t)j * m_numSymbols + symbol];
+            buy = std::max(buy, prevSell - price);
+            sell = std::max(sell, buy + price);
+            prevSell = sell;
+        }
+    }
+
+    void UpdateBatch(const int* prices, int numTicks)
+    {
+        for (int t = 0; t < numTicks; t++)
+        {
+            const int* row = prices + (size_t)t * m_numSymbols;
+            int s = 0;
+#if MAX_PROFIT_SSE2
+            for (; s + 4 <= m_numSymbols; s += 4)
+            {
+                __m128i p = _mm_loadu_si128((const __m128i*)&row[s]);
+                __m128i prevSell = _mm_setzero_si128();
+                for (int j = 0; j < m_k; j++)
+                {
+                    int* buy = &m_buy[(size_t)j * m_numSymbols + s];
+                    int* sell = &m_sell[(size_t)j * m_numSymbols + s];
+                    __m128i b = max_epi32(_mm_loadu_si128((const __m128i*)buy), _mm_sub_epi32(prevSell, p));
+                    __m128i v = max_epi32(_mm_loadu_si128((const __m128i*)sell), _mm_add_epi32(b, p));
+                    _mm_storeu_si128((__m128i*)buy, b);
+                    _mm_storeu_si128((__m128i*)sell, v);
+                    prevSell = v;
+                }
+            }
+#endif
+            for (; s < m_numSymbols; s++)
+                Update(s, row[s]);
+        }
+    }
+
+    int Profit(int symbol) const { return m_sell[(size_t)(m_k - 1) * m_numSymbols + symbol]; }
+};
+
+// Unlimited transactions, but no buy on the tick right after a sell. Three states
+// per symbol: holding, just sold (cooling down), and free to buy.
+struct MultiSymbolProfitCooldown
+{
+    int m_numSymbols;
+    std::vector<int> m_hold;
+    std::vector<int> m_sold;
+    std::vector<int> m_rest;
+
+    void Reset(int numSymbols)
+    {
+        m_numSymbols = numSymbols;
+        m_hold.assign(numSymbols, kNoPosition);
+        m_sold.assign(numSymbols, 0);
+        m_rest.assign(numSymbols, 0);
+    }
+
+    void Update(int symbol, int price)
+    {
+        const int hold = m_hold[symbol];
+        m_hold[symbol] = std::max(hold, m_rest[symbol] - price);
+        m_rest[symbol] = std::max(m_rest[symbol], m_sold[symbol]);
+        m_sold[symbol] = hold + price;
+    }
+
+    void UpdateBatch(const int* prices, int numTicks)
+    {
+        for (int t = 0; t < numTicks; t++)
+        {
+            const int* row = prices + (size_t)t * m_numSymbols;
+            int s = 0;
+#if MAX_PROFIT_SSE2
+            for (; s + 4 <= m_numSymbols; s += 4)
+            {
+                __m128i p = _mm_loadu_si128((const __m128i*)&row[s]);
+                __m128i hold = _mm_loadu_si128((const __m128i*)&m_hold[s]);
+                __m128i sold = _mm_loadu_si128((const __m128i*)&m_sold[s]);
+                __m128i rest = _mm_loadu_si128((const __m128i*)&m_rest[s]);
+                _mm_storeu_si128((__m128i*)&m_hold[s], max_epi32(hold, _mm_sub_epi32(rest, p)));
+                _mm_storeu_si128((__m128i*)&m_rest[s], max_epi32(rest, sold));
+                _mm_storeu_si128((__m128i*)&m_sold[s], _mm_add_epi32(hold, p));
+            }
+#endif
+            for (; s < m_numSymbols; s++)
+                Update(s, row[s]);
+        }
+    }
+
+    int Profit(int symbol) const { return std::max(m_sold[symbol], m_rest[symbol]); }
+};
+
 static int maxProfit(const int* prices, int n) {
     //return solution1(prices, n);
-    //return DP(prices, n, 0, n - 1).GetProfile(prices, n);
+    //return DP(prices, n).GetProfile(prices, n);
+    //return max_profit_parallel(prices, n).profit;
     return solution3(prices, n);
 }
 
@@ -106,4 +411,120 @@ void test_max_profit()
 
     int max_profit = maxProfit(seq, nseq);
     printf("max_profit: %d\n", max_profit);
-}
\ No newline at end of file
+
+    DpRes dp = DP(seq, nseq);
+    printf("memoized DP: %d (buy %d, sell %d)\n", dp.GetProfile(seq, nseq), dp.i_buy, dp.i_sell);
+
+    ProfitSummary summary = max_profit_parallel(seq, nseq);
+    printf("parallel: %d (buy %lld, sell %lld)\n", summary.profit, summary.buyIndex, summary.sellIndex);
+
+    // three symbols, ticks interleaved: row t holds one price per symbol
+    const int numSymbols = 3;
+    int ticks[][numSymbols] = {
+        { 7, 3, 1 }, { 1, 2, 2 }, { 5, 3, 3 }, { 3, 0, 0 }, { 6, 2, 2 }, { 4, 8, 4 }, { 1, 1, 1 },
+    };
+    int numTicks = sizeof(ticks) / sizeof(ticks[0]);
+
+    MultiSymbolProfit single;
+    MultiSymbolProfitK twice;
+    MultiSymbolProfitCooldown cooldown;
+    single.Reset(numSymbols);
+    twice.Reset(numSymbols, 2);
+    cooldown.Reset(numSymbols);
+    single.UpdateBatch(&ticks[0][0], numTicks);
+    twice.UpdateBatch(&ticks[0][0], numTicks);
+    cooldown.UpdateBatch(&ticks[0][0], numTicks);
+    for (int s = 0; s < numSymbols; s++)
+        printf("symbol %d: one trade %d, two trades %d, cooldown %d\n", s, single.Profit(s), twice.Profit(s), cooldown.Profit(s));
+}
+
+static BenchBody bench_max_profit(int n, std::mt19937& rng)
+{
+    std::vector<int> prices = random_walk(n, 100000, 100, rng);
+    return [prices]() { bench_consume(maxProfit(prices.data(), (int)prices.size())); };
+}
+
+// n ticks for each of 10^4 symbols, tick-major as they arrive from a replay
+static const int kBenchSymbols = 10000;
+
+static std::vector<int> random_ticks(int numTicks, std::mt19937& rng)
+{
+    std::vector<int> ticks((size_t)numTicks * kBenchSymbols);
+    for (int s = 0; s < kBenchSymbols; s++)
+    {
+        std::vector<int> walk = random_walk(numTicks, 100000, 100, rng);
+        for (int t = 0; t < numTicks; t++)
+            ticks[(size_t)t * kBenchSymbols + s] = walk[t];
+    }
+    return ticks;
+}
+
+static BenchBody bench_max_profit_symbols(int n, std::mt19937& rng)
+{
+    std::vector<int> ticks = random_ticks(n, rng);
+    return [ticks, n]()
+    {
+        MultiSymbolProfit book;
+        book.Reset(kBenchSymbols);
+        book.UpdateBatch(ticks.data(), n);
+        bench_consume(book.Profit(kBenchSymbols - 1));
+    };
+}
+
+// the same ticks one Update() call at a time, for comparison
+static BenchBody bench_max_profit_symbols_scalar(int n, std::mt19937& rng)
+{
+    std::vector<int> ticks = random_ticks(n, rng);
+    return [ticks, n]()
+    {
+        MultiSymbolProfit book;
+        book.Reset(kBenchSymbols);
+        for (size_t i = 0; i < ticks.size(); i++)
+            book.Update((int)(i % kBenchSymbols), ticks[i]);
+        bench_consume(book.Profit(kBenchSymbols - 1));
+    };
+}
+
+static BenchBody bench_max_profit_k(int n, std::mt19937& rng)
+{
+    std::vector<int> ticks = random_ticks(n, rng);
+    return [ticks, n]()
+    {
+        MultiSymbolProfitK book;
+        book.Reset(kBenchSymbols, 4);
+        book.UpdateBatch(ticks.data(), n);
+        bench_consume(book.Profit(kBenchSymbols - 1));
+    };
+}
+
+static BenchBody bench_max_profit_cooldown(int n, std::mt19937& rng)
+{
+    std::vector<int> ticks = random_ticks(n, rng);
+    return [ticks, n]()
+    {
+        MultiSymbolProfitCooldown book;
+        book.Reset(kBenchSymbols);
+        book.UpdateBatch(ticks.data(), n);
+        bench_consume(book.Profit(kBenchSymbols - 1));
+    };
+}
+
+static BenchBody bench_max_profit_dp(int n, std::mt19937& rng)
+{
+    std::vector<int> prices = random_walk(n, 100000, 100, rng);
+    return [prices]() { bench_consume(DP(prices.data(), (int)prices.size()).GetProfile(prices.data(), (int)prices.size())); };
+}
+
+static BenchBody bench_max_profit_parallel(int n, std::mt19937& rng)
+{
+    std::vector<int> prices = random_walk(n, 100000, 100, rng);
+    return [prices]() { bench_consume(max_profit_parallel(prices.data(), (long long)prices.size()).profit); };
+}
+
+REGISTER_BENCHMARK(max_profit, bench_max_profit, 1000000, 10000000);
+REGISTER_BENCHMARK(max_profit_dp, bench_max_profit_dp, 1000, 4000);
+REGISTER_BENCHMARK(max_profit_parallel, bench_max_profit_parallel, 20000000, 500000000);
+REGISTER_BENCHMARK(max_profit_symbols, bench_max_profit_symbols, 1000, 10000);
+REGISTER_BENCHMARK(max_profit_symbols_scalar, bench_max_profit_symbols_scalar, 1000, 10000);
+REGISTER_BENCHMARK(max_profit_k, bench_max_profit_k, 1000, 10000);
+REGISTER_BENCHMARK(max_profit_cooldown, bench_max_profit_cooldown, 1000, 10000);
@@ -0,0 +1,471 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "benchmark.h"
+#include "string_edit_distance.h"
+
+// BK-tree over the edit distance of string_edit_distance.cpp. Every child edge is
+// labelled with its distance to the parent, so by the triangle inequality a query
+// at distance d from a node only needs the children labelled d - k .. d + k.
+//
+// The finished tree is one flat, pointer-free image (header, nodes, text) that
+// is written to disk as is and queried straight out of an mmap of the file.
+// Fields are native-endian.
+
+struct BkTreeHeader
+{
+	char magic[4];			// "BKT1"
+	uint32_t numNodes;
+	uint32_t textBytes;
+	uint32_t reserved;
+};
+
+// Nodes are in breadth-first order, so the children of a node are contiguous
+// and sorted by parentDist.
+struct BkTreeNode
+{
+	uint32_t textOffset;
+	uint32_t textLength;
+	uint32_t id;			// caller's id of the entry
+	uint32_t firstChild;
+	uint32_t numChildren;
+	uint32_t parentDist;	// edge label, distance to the parent
+	uint32_t maxChildDist;	// largest child edge label
+};
+
+struct BkTreeMatch
+{
+	uint32_t id;
+	int dist;
+	const char* word;
+	int len;
+};
+
+struct BkTreeBuilder
+{
+	struct Node
+	{
+		std::string word;
+		uint32_t id;
+		int parentDist;
+		int firstChild;
+		int nextSibling;
+	};
+
+	std::vector<Node> m_nodes;
+	BitParallelEditDistance m_bp;
+
+	// duplicates of an existing word are dropped; returns whether word was added
+	bool Add(const char* word, int len, uint32_t id)
+	{
+		Node node;
+		node.word.assign(word, len);
+		node.id = id;
+		node.parentDist = 0;
+		node.firstChild = -1;
+		node.nextSibling = -1;
+
+		if (m_nodes.empty())
+		{
+			m_nodes.push_back(node);
+			return true;
+		}
+
+		int cur = 0;
+		for (;;)
+		{
+			const std::string& w = m_nodes[cur].word;
+			const int d = m_bp.Compute(word, len, w.c_str(), (int)w.size());
+			if (d == 0)
+				return false;
+
+			int child = m_nodes[cur].firstChild;
+			while (child >= 0 && m_nodes[child].parentDist != d)
+				child = m_nodes[child].nextSibling;
+
+			if (child < 0)
+			{
+				node.parentDist = d;
+				node.nextSibling = m_nodes[cur].firstChild;
+				m_nodes.push_back(node);
+				m_nodes[cur].firstChild = (int)m_nodes.size() - 1;
+				return true;
+			}
+			cur = child;
+		}
+	}
+
+	// the flat image, byte for byte what Save() writes
+	std::vector<char> Serialize() const
+	{
+		// breadth-first renumbering with children sorted by edge label
+		std::vector<int> order;
+		order.reserve(m_nodes.size());
+		std::vector<uint32_t> firstChild(m_nodes.size(), 0);
+		std::vector<uint32_t> numChildren(m_nodes.size(), 0);
+		std::vector<uint32_t> maxChildDist(m_nodes.size(), 0);
+		if (!m_nodes.empty())
+			order.push_back(0);
+
+		std::vector<int> children;
+		for (size_t i = 0; i < order.size(); i++)
+		{
+			children.clear();
+			for (int c = m_nodes[order[i]].firstChild; c >= 0; c = m_nodes[c].nextSibling)
+				children.push_back(c);
+			std::sort(children.begin(), children.end(),
+				[this](int a, int b) { return m_nodes[a].parentDist < m_nodes[b].parentDist; });
+
+			firstChild[i] = (uint32_t)order.size();
+			numChildren[i] = (uint32_t)children.size();
+			maxChildDist[i] = children.empty() ? 0 : m_nodes[children.back()].parentDist;
+			order.insert(order.end(), children.begin(), children.end());
+		}
+
+		size_t textBytes = 0;
+		for (size_t i = 0; i < m_nodes.size(); i++)
+			textBytes += m_nodes[i].word.size();
+
+		const size_t nodesOffset = sizeof(BkTreeHeader);
+		const size_t textOffset = nodesOffset + sizeof(BkTreeNode) * m_nodes.size();
+		std::vector<char> image(textOffset + textBytes);
+
+		BkTreeHeader header;
+		memcpy(header.magic, "BKT1", 4);
+		header.numNodes = (uint32_t)m_nodes.size();
+		header.textBytes = (uint32_t)textBytes;
+		header.reserved = 0;
+		memcpy(&image[0], &header, sizeof(header));
+
+		uint32_t text = 0;
+		for (size_t i = 0; i < order.size(); i++)
+		{
+			const Node& src = m_nodes[order[i]];
+			BkTreeNode node;
+			node.textOffset = text;
+			node.textLength = (uint32_t)src.word.size();
+			node.id = src.id;
+			node.firstChild = firstChild[i];
+			node.numChildren = numChildren[i];
+			node.parentDist = (uint32_t)src.parentDist;
+			node.maxChildDist = maxChildDist[i];
+			memcpy(&image[nodesOffset + i * sizeof(BkTreeNode)], &node, sizeof(node));
+			if (!src.word.empty())
+				memcpy(&image[textOffset + text], src.word.data(), src.word.size());
+			text += node.textLength;
+		}
+		return image;
+	}
+
+	bool Save(const char* filename) const
+	{
+		std::vector<char> image = Serialize();
+		std::ofstream out(filename, std::ios::binary);
+		out.write(image.data(), image.size());
+		return (bool)out;
+	}
+};
+
+// Read-only view over a flat image in memory or in a mapped file.
+struct BkTreeView
+{
+	const BkTreeHeader* m_header = nullptr;
+	const BkTreeNode* m_nodes = nullptr;
+	const char* m_text = nullptr;
+
+	bool Attach(const char* data, size_t size)
+	{
+		if (size < sizeof(BkTreeHeader) || memcmp(data, "BKT1", 4) != 0)
+			return false;
+
+		const BkTreeHeader* header = (const BkTreeHeader*)data;
+		const size_t textOffset = sizeof(BkTreeHeader) + sizeof(BkTreeNode) * (size_t)header->numNodes;
+		if (size < textOffset + header->textBytes)
+			return false;
+
+		// Query follows child ranges and text ranges read from the file, so every
+		// node is checked once here. Children come after their parent in
+		// breadth-first order, which also rules out cycles.
+		const BkTreeNode* nodes = (const BkTreeNode*)(data + sizeof(BkTreeHeader));
+		for (uint32_t i = 0; i < header->numNodes; i++)
+		{
+			const BkTreeNode& node = nodes[i];
+			if ((uint64_t)node.textOffset + node.textLength > header->textBytes)
+				return false;
+			if (node.numChildren > 0 &&
+				(node.firstChild <= i || (uint64_t)node.firstChild + node.numChildren > header->numNodes))
+				return false;
+		}
+
+		m_header = header;
+		m_nodes = nodes;
+		m_text = data + textOffset;
+		return true;
+	}
+
+	// Appends every entry within distance k of the query to out and returns the
+	// number of distance computations it took.
+	int Query(const char* q, int len, int k, BitParallelEditDistance& bp, std::vector<BkTreeMatch>* out) const
+	{
+		int numEvaluations = 0;
+		if (!m_header || m_header->numNodes == 0)
+			return 0;
+
+		std::vector<uint32_t> stack;
+		stack.push_back(0);
+		while (!stack.empty())
+		{
+			const BkTreeNode& node = m_nodes[stack.back()];
+			stack.pop_back();
+
+			// beyond maxChildDist + k neither this node nor any child can match,
+			// so the exact distance isn't needed
+			const char* word = m_text + node.textOffset;
+			const int limit = (int)node.maxChildDist + k;
+			const int d = bp.Compute(q, len, word, (int)node.textLength, limit);
+			numEvaluations++;
+			if (d < 0)
+				continue;
+
+			if (d <= k)
+			{
+				BkTreeMatch m = { node.id, d, word, (int)node.textLength };
+				out->push_back(m);
+			}
+
+			// children are sorted by edge label: visit those in [d - k, d + k]
+			const BkTreeNode* first = m_nodes + node.firstChild;
+			const BkTreeNode* last = first + node.numChildren;
+			const uint32_t lo = (uint32_t)std::max(d - k, 0);
+			const BkTreeNode* child = std::lower_bound(first, last, lo,
+				[](const BkTreeNode& n, uint32_t v) { return n.parentDist < v; });
+			for (; child != last && (int)child->parentDist <= d + k; ++child)
+				stack.push_back((uint32_t)(child - m_nodes));
+		}
+		return numEvaluations;
+	}
+};
+
+// Read-only memory map of a whole file.
+struct MappedFile
+{
+	const char* m_data = nullptr;
+	size_t m_size = 0;
+#ifdef _WIN32
+	HANDLE m_file = INVALID_HANDLE_VALUE;
+	HANDLE m_mapping = NULL;
+#endif
+
+	~MappedFile() { Close(); }
+
+	bool Open(const char* filename)
+	{
+		Close();
+#ifdef _WIN32
+		m_file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (m_file == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0)
+		{
+			Close();
+			return false;
+		}
+
+		m_mapping = CreateFileMappingA(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (!m_mapping)
+		{
+			Close();
+			return false;
+		}
+
+		m_data = (const char*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+		m_size = (size_t)size.QuadPart;
+#else
+		int fd = open(filename, O_RDONLY);
+		if (fd < 0)
+			return false;
+
+		struct stat st;
+		if (fstat(fd, &st) != 0 || st.st_size == 0)
+		{
+			close(fd);
+			return false;
+		}
+
+		void* p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (p == MAP_FAILED)
+			return false;
+
+		m_data = (const char*)p;
+		m_size = (size_t)st.st_size;
+#endif
+		return m_data != nullptr;
+	}
+
+	void Close()
+	{
+#ifdef _WIN32
+		if (m_data)
+			UnmapViewOfFile(m_data);
+		if (m_mapping)
+			CloseHandle(m_mapping);
+		if (m_file != INVALID_HANDLE_VALUE)
+			CloseHandle(m_file);
+		m_mapping = NULL;
+		m_file = INVALID_HANDLE_VALUE;
+#else
+		if (m_data)
+			munmap((void*)m_data, m_size);
+#endif
+		m_data = nullptr;
+		m_size = 0;
+	}
+};
+
+static void print_matches(const char* q, int k, int numEvaluations, std::vector<BkTreeMatch>& matches)
+{
+	std::sort(matches.begin(), matches.end(),
+		[](const BkTreeMatch& a, const BkTreeMatch& b) { return a.dist != b.dist ? a.dist < b.dist : a.id < b.id; });
+
+	printf("\"%s\" k=%d (%d distances):", q, k, numEvaluations);
+	for (size_t i = 0; i < matches.size(); i++)
+		printf(" %.*s(%d)", matches[i].len, matches[i].word, matches[i].dist);
+	printf("\n");
+}
+
+void test_bk_tree()
+{
+	const char* words[] = { "hell", "help", "shel", "smell", "fell", "felt", "oops", "pop", "oouch", "halt", "hello", "yellow", "held" };
+	const int nwords = sizeof(words) / sizeof(words[0]);
+
+	BkTreeBuilder builder;
+	for (int i = 0; i < nwords; i++)
+		builder.Add(words[i], (int)strlen(words[i]), i);
+
+	std::vector<char> image = builder.Serialize();
+	BkTreeView tree;
+	tree.Attach(image.data(), image.size());
+
+	BitParallelEditDistance bp;
+	std::vector<BkTreeMatch> matches;
+	const char* queries[] = { "helo", "pops", "felt" };
+	for (int i = 0; i < 3; i++)
+	{
+		matches.clear();
+		int evals = tree.Query(queries[i], (int)strlen(queries[i]), 1, bp, &matches);
+		print_matches(queries[i], 1, evals, matches);
+	}
+
+	// a child range past the last node is refused
+	std::vector<char> corrupt = image;
+	BkTreeNode* root = (BkTreeNode*)(corrupt.data() + sizeof(BkTreeHeader));
+	root->numChildren = nwords + 1;
+	BkTreeView rejected;
+	printf("corrupt image attached: %d\n", rejected.Attach(corrupt.data(), corrupt.size()));
+
+	// same queries through a memory-mapped copy
+	const std::string path = bench_temp_path("bk_tree_test");
+	const char* filename = path.c_str();
+	MappedFile file;
+	BkTreeView mapped;
+	if (builder.Save(filename) && file.Open(filename) && mapped.Attach(file.m_data, file.m_size))
+	{
+		matches.clear();
+		int evals = mapped.Query("helo", 4, 2, bp, &matches);
+		print_matches("helo (mmap)", 2, evals, matches);
+	}
+	else
+	{
+		printf("couldn't write or map %s\n", filename);
+	}
+	file.Close();
+	remove(filename);
+}
+
+struct BkTreeBench
+{
+	std::vector<std::string> words;
+	std::vector<std::string> queries;
+	std::vector<char> image;
+};
+
+static BkTreeBench* make_bk_tree_bench(int n, std::mt19937& rng)
+{
+	BkTreeBench* bench = new BkTreeBench;
+	std::uniform_int_distribution<int> len(6, 12);
+	for (int i = 0; i < n; i++)
+		bench->words.push_back(random_string(len(rng), "abcdefghijklmnopqrstuvwxyz", rng));
+
+	// queries are dictionary words with one typo, looked up with k = 1
+	std::uniform_int_distribution<int> pick(0, n - 1);
+	for (int i = 0; i < 100; i++)
+	{
+		std::string q = bench->words[pick(rng)];
+		q[rng() % q.size()] = 'a' + rng() % 26;
+		bench->queries.push_back(q);
+	}
+
+	BkTreeBuilder builder;
+	for (int i = 0; i < n; i++)
+		builder.Add(bench->words[i].c_str(), (int)bench->words[i].size(), i);
+	bench->image = builder.Serialize();
+	return bench;
+}
+
+static BenchBody bench_bk_tree_query(int n, std::mt19937& rng)
+{
+	std::shared_ptr<BkTreeBench> bench(make_bk_tree_bench(n, rng));
+	return [bench]()
+	{
+		BkTreeView tree;
+		tree.Attach(bench->image.data(), bench->image.size());
+		BitParallelEditDistance bp;
+		std::vector<BkTreeMatch> matches;
+		for (size_t i = 0; i < bench->queries.size(); i++)
+			tree.Query(bench->queries[i].c_str(), (int)bench->queries[i].size(), 1, bp, &matches);
+		bench_consume((long long)matches.size());
+	};
+}
+
+// the same queries as a thresholded scan over every entry
+static BenchBody bench_bk_tree_scan(int n, std::mt19937& rng)
+{
+	std::shared_ptr<BkTreeBench> bench(make_bk_tree_bench(n, rng));
+	return [bench]()
+	{
+		BitParallelEditDistance bp;
+		long long found = 0;
+		for (size_t i = 0; i < bench->queries.size(); i++)
+		{
+			const std::string& q = bench->queries[i];
+			for (size_t w = 0; w < bench->words.size(); w++)
+				found += bp.Compute(q.c_str(), (int)q.size(), bench->words[w].c_str(), (int)bench->words[w].size(), 1) >= 0;
+		}
+		bench_consume(found);
+	};
+}
+
+REGISTER_BENCHMARK(bk_tree_query, bench_bk_tree_query, 100000, 2000000);
+REGISTER_BENCHMARK(bk_tree_scan, bench_bk_tree_scan, 100000, 2000000);
@@ -1,4 +1,13 @@
 #include <stdio.h>
+#include <assert.h>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define COIN_CHANGE_SSE2 1
+#endif
+
+#include "benchmark.h"
 
 int DP(const int* coins, int n, int remainingAmount, int num_prev)
 {
@@ -40,6 +49,101 @@ int coinChange(const int* coins, int n, int amount)
     return v == 0x7FFFFFFF ? -1 : v;
 }
 
+// Bottom-up min-coins table for one denomination set. Build() fills it once in
+// O(n * max_amount); after that any amount up to max_amount is an O(1) lookup,
+// and the coins themselves are recovered by following m_lastCoin.
+struct CoinChangeTable
+{
+    enum { kUnreachable = 0x3FFFFFFF }; // +1 can't overflow
+
+    std::vector<int> m_coins;
+    std::vector<int> m_minCoins;    // fewest coins summing to each amount
+    std::vector<int> m_lastCoin;    // index of a coin that ends an optimal solution, -1 if none
+    int m_maxAmount = 0;
+
+    void Build(const int* coins, int n, int maxAmount)
+    {
+        assert(maxAmount >= 0);
+        m_coins.assign(coins, coins + n);
+        m_maxAmount = maxAmount;
+        m_minCoins.assign(maxAmount + 1, kUnreachable);
+        m_lastCoin.assign(maxAmount + 1, -1);
+        m_minCoins[0] = 0;
+
+        // coin by coin (unbounded knapsack order): t[a] = min(t[a], t[a - c] + 1)
+        for (int i = 0; i < n; i++)
+        {
+            const int c = m_coins[i];
+            if (c <= 0 || c > maxAmount)
+                continue;
+
+            int a = c;
+#if COIN_CHANGE_SSE2
+            // 4 lanes read t[a - c .. a - c + 3], which this pass has already
+            // finished as long as c >= 4
+            if (c >= 4)
+            {
+                const __m128i ones = _mm_set1_epi32(1);
+                const __m128i coinIndex = _mm_set1_epi32(i);
+                for (; a + 4 <= maxAmount + 1; a += 4)
+                {
+                    __m128i cur = _mm_loadu_si128((const __m128i*)&m_minCoins[a]);
+                    __m128i cand = _mm_add_epi32(_mm_loadu_si128((const __m128i*)&m_minCoins[a - c]), ones);
+                    __m128i better = _mm_cmplt_epi32(cand, cur);
+                    __m128i last = _mm_loadu_si128((const __m128i*)&m_lastCoin[a]);
+                    cur = _mm_or_si128(_mm_and_si128(better, cand), _mm_andnot_si128(better, cur));
+                    last = _mm_or_si128(_mm_and_si128(better, coinIndex), _mm_andnot_si128(better, last));
+                    _mm_storeu_si128((__m128i*)&m_minCoins[a], cur);
+                    _mm_storeu_si128((__m128i*)&m_lastCoin[a], last);
+                }
+            }
+#endif
+            for (; a <= maxAmount; a++)
+            {
+                const int cand = m_minCoins[a - c] + 1;
+                if (cand < m_minCoins[a])
+                {
+                    m_minCoins[a] = cand;
+                    m_lastCoin[a] = i;
+                }
+            }
+        }
+    }
+
+    // fewest coins for amount, or -1 when it can't be made
+    int Query(int amount) const
+    {
+        assert(amount >= 0 && amount <= m_maxAmount);
+        const int v = m_minCoins[amount];
+        return v >= kUnreachable ? -1 : v;
+    }
+
+    void QueryBatch(const int* amounts, int num, int* results) const
+    {
+        for (int i = 0; i < num; i++)
+            results[i] = Query(amounts[i]);
+    }
+
+    // writes the chosen denominations to outCoins (at least Query(amount)
+    // entries), returns their count or -1 when the amount can't be made
+    int Reconstruct(int amount, int* outCoins) const
+    {
+        const int num = Query(amount);
+        if (num < 0)
+            return -1;
+
+        int k = 0;
+        while (amount > 0)
+        {
+            const int c = m_coins[m_lastCoin[amount]];
+            outCoins[k++] = c;
+            amount -= c;
+        }
+        assert(k == num);
+        return k;
+    }
+};
+
 void test_coin_change()
 {
     int coins[] = { 1, 2, 5 };
@@ -49,4 +153,51 @@ void test_coin_change()
     int v = coinChange(coins, ncoins, amount);
 
     printf("v: %d\n", v);
-}
\ No newline at end of file
+
+    CoinChangeTable table;
+    table.Build(coins, ncoins, 100);
+
+    int amounts[] = { 0, 3, 11, 23, 99, 100 };
+    int namounts = sizeof(amounts) / sizeof(amounts[0]);
+    int results[sizeof(amounts) / sizeof(amounts[0])];
+    table.QueryBatch(amounts, namounts, results);
+
+    for (int i = 0; i < namounts; i++)
+    {
+        int chosen[100];
+        int nchosen = table.Reconstruct(amounts[i], chosen);
+        printf("amount %d: %d coins {", amounts[i], results[i]);
+        for (int k = 0; k < nchosen; k++)
+            printf(" %d", chosen[k]);
+        printf(" }\n");
+    }
+}
+
+static BenchBody bench_coin_change(int n, std::mt19937& rng)
+{
+    // 1 plus two random denominations, so every amount is reachable
+    std::vector<int> coins = random_ints(2, 2, 20, rng);
+    coins.push_back(1);
+    return [coins, n]() { bench_consume(coinChange(coins.data(), (int)coins.size(), n)); };
+}
+
+REGISTER_BENCHMARK(coin_change, bench_coin_change, 20, 32);
+
+// builds the table up to n, then answers a batch of queries against it
+static BenchBody bench_coin_change_table(int n, std::mt19937& rng)
+{
+    std::vector<int> coins = random_ints(7, 2, 500, rng);
+    coins.push_back(1);
+    std::vector<int> amounts = random_ints(10000, 0, n, rng);
+    return [coins, amounts, n]()
+    {
+        CoinChangeTable table;
+        table.Build(coins.data(), (int)coins.size(), n);
+
+        std::vector<int> results(amounts.size());
+        table.QueryBatch(amounts.data(), (int)amounts.size(), results.data());
+        bench_consume(results[0] + results.back());
+    };
+}
+
+REGISTER_BENCHMARK(coin_change_table, bench_coin_change_table, 1000000, 10000000);
@@ -0,0 +1,338 @@
+#include <stdio.h>
+#include <assert.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "benchmark.h"
+#include "parallel.h"
+#include "toplogical_sort.h"
+
+// A DAG of callables: a task runs once every task it depends on has finished.
+struct TaskGraph
+{
+	std::vector<std::function<void()>> m_tasks;
+	std::vector<std::pair<int, int>> m_edges;
+
+	int AddTask(const std::function<void()>& fn)
+	{
+		m_tasks.push_back(fn);
+		return (int)m_tasks.size() - 1;
+	}
+
+	void AddDependency(int before, int after)
+	{
+		assert(before >= 0 && before < (int)m_tasks.size());
+		assert(after >= 0 && after < (int)m_tasks.size());
+		m_edges.push_back(std::make_pair(before, after));
+	}
+};
+
+struct DagRunStats
+{
+	int numThreads = 0;
+	int numSteals = 0;
+	double wallMs = 0.0;
+	double busyMs = 0.0;		// summed over workers, time spent inside tasks
+	double idleMs = 0.0;		// numThreads * wallMs - busyMs
+	double parallelism = 0.0;	// busyMs / wallMs, the average number of running tasks
+};
+
+// One deque per worker: the owner pushes and pops at the back (newest first, so a
+// task's successors run while its data is still in cache), thieves take from the
+// front. A mutex per deque keeps it simple; contention is rare because a worker
+// only touches another's deque when its own is empty.
+struct WorkDeque
+{
+	std::mutex m_lock;
+	std::deque<int> m_items;
+
+	void Push(int task)
+	{
+		std::lock_guard<std::mutex> guard(m_lock);
+		m_items.push_back(task);
+	}
+
+	bool Pop(int* task)
+	{
+		std::lock_guard<std::mutex> guard(m_lock);
+		if (m_items.empty())
+			return false;
+		*task = m_items.back();
+		m_items.pop_back();
+		return true;
+	}
+
+	bool Steal(int* task)
+	{
+		std::lock_guard<std::mutex> guard(m_lock);
+		if (m_items.empty())
+			return false;
+		*task = m_items.front();
+		m_items.pop_front();
+		return true;
+	}
+};
+
+// Where a worker with nothing to pop or steal goes to sleep, so an idle core is
+// really idle. m_queued counts tasks sitting in deques. A sleeper registers in
+// m_sleeping before it rechecks m_queued, and a pusher reads m_sleeping after
+// raising m_queued (both sequentially consistent), so a wakeup can't be lost
+// and a push takes the lock only when someone is asleep.
+struct WorkerParking
+{
+	std::mutex m_lock;
+	std::condition_variable m_wake;
+	std::atomic<int> m_queued{0};
+	std::atomic<int> m_sleeping{0};
+	std::atomic<bool> m_stopped{false};
+
+	void TaskQueued()
+	{
+		m_queued++;
+		if (m_sleeping.load() > 0)
+		{
+			// a sleeper holds the lock from its check until it waits
+			{ std::lock_guard<std::mutex> guard(m_lock); }
+			m_wake.notify_one();
+		}
+	}
+
+	void TaskTaken() { m_queued--; }
+
+	void Stop()
+	{
+		m_stopped = true;
+		{ std::lock_guard<std::mutex> guard(m_lock); }
+		m_wake.notify_all();
+	}
+
+	void Park()
+	{
+		std::unique_lock<std::mutex> lock(m_lock);
+		m_sleeping++;
+		m_wake.wait(lock, [this]() { return m_queued.load() > 0 || m_stopped.load(); });
+		m_sleeping--;
+	}
+};
+
+// Runs every task of the graph on numThreads workers (0 = one per core). The
+// dependency counts are the Kahn in-degrees, decremented atomically; whoever takes a
+// count to zero pushes that task onto its own deque. A worker that finds no work
+// for a few rounds parks until a task is pushed. Returns false, running nothing,
+// if the graph has a cycle. If a task throws, no further tasks start, the running
+// ones finish and the first exception is rethrown once all workers have joined.
+static bool run_task_graph(const TaskGraph& tasks, int numThreads, DagRunStats* stats)
+{
+	typedef std::chrono::steady_clock Clock;
+
+	const int n = (int)tasks.m_tasks.size();
+	CsrGraph graph;
+	graph.Build(n, tasks.m_edges);
+
+	std::vector<int> order;
+	if (csr_top_sort(graph, &order))
+		return false;
+
+	if (numThreads <= 0)
+		numThreads = default_num_threads();
+
+	std::unique_ptr<std::atomic<int>[]> pending(new std::atomic<int>[n]);
+	for (int v = 0; v < n; v++)
+		pending[v].store(graph.m_inDegree[v], std::memory_order_relaxed);
+
+	std::vector<std::unique_ptr<WorkDeque>> deques;
+	for (int i = 0; i < numThreads; i++)
+		deques.emplace_back(new WorkDeque());
+
+	// sources are dealt round-robin so every worker starts with something
+	WorkerParking parking;
+	int numSources = 0;
+	for (int v = 0; v < n; v++)
+	{
+		if (graph.m_inDegree[v] == 0)
+		{
+			deques[numSources++ % numThreads]->Push(v);
+			parking.TaskQueued();
+		}
+	}
+
+	std::atomic<int> remaining(n);
+	std::atomic<int> numSteals(0);
+	std::mutex errorLock;
+	std::exception_ptr error;
+	std::vector<double> busyMs(numThreads, 0.0);
+
+	auto worker = [&](int self)
+	{
+		const int kSpinRounds = 16;
+		double busy = 0.0;
+		int steals = 0;
+		int misses = 0;
+		while (remaining.load(std::memory_order_acquire) > 0 && !parking.m_stopped.load())
+		{
+			int task = -1;
+			bool found = deques[self]->Pop(&task);
+			for (int k = 1; !found && k < numThreads; k++)
+			{
+				found = deques[(self + k) % numThreads]->Steal(&task);
+				steals += found ? 1 : 0;
+			}
+			if (!found)
+			{
+				if (++misses < kSpinRounds)
+				{
+					std::this_thread::yield();
+				}
+				else
+				{
+					parking.Park();
+					misses = 0;
+				}
+				continue;
+			}
+			misses = 0;
+			parking.TaskTaken();
+
+			Clock::time_point start = Clock::now();
+			try
+			{
+				tasks.m_tasks[task]();
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> guard(errorLock);
+				if (!error)
+					error = std::current_exception();
+				parking.Stop();
+				break;
+			}
+			busy += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+			for (const int* w = graph.OutBegin(task); w != graph.OutEnd(task); w++)
+			{
+				if (pending[*w].fetch_sub(1, std::memory_order_acq_rel) == 1)
+				{
+					deques[self]->Push(*w);
+					parking.TaskQueued();
+				}
+			}
+			if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+				parking.Stop();
+		}
+		busyMs[self] = busy;
+		numSteals += steals;
+	};
+
+	Clock::time_point start = Clock::now();
+	std::vector<std::thread> threads;
+	for (int i = 1; i < numThreads; i++)
+		threads.emplace_back(worker, i);
+	worker(0);
+	for (size_t i = 0; i < threads.size(); i++)
+		threads[i].join();
+	const double wallMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	if (error)
+		std::rethrow_exception(error);
+
+	if (stats)
+	{
+		stats->numThreads = numThreads;
+		stats->numSteals = numSteals.load();
+		stats->wallMs = wallMs;
+		stats->busyMs = 0.0;
+		for (int i = 0; i < numThreads; i++)
+			stats->busyMs += busyMs[i];
+		stats->idleMs = numThreads * wallMs - stats->busyMs;
+		stats->parallelism = wallMs > 0.0 ? stats->busyMs / wallMs : 0.0;
+	}
+	return true;
+}
+
+static void spin(int iterations)
+{
+	volatile unsigned int x = 0;	// unsigned, so the sum wraps instead of overflowing
+	for (int i = 0; i < iterations; i++)
+		x = x + (unsigned int)i;
+}
+
+void test_dag_executor()
+{
+	// one frame of an ECS-style update: systems that don't share components run
+	// side by side
+	const char* names[] = { "input", "ai", "physics", "animation", "audio", "transforms", "culling", "render" };
+	const int numSystems = sizeof(names) / sizeof(names[0]);
+
+	std::atomic<int> clock(0);
+	std::vector<int> finishedAt(numSystems);
+
+	TaskGraph frame;
+	for (int i = 0; i < numSystems; i++)
+		frame.AddTask([&, i]() { spin(200000); finishedAt[i] = clock++; });
+
+	frame.AddDependency(0, 1);	// input -> ai
+	frame.AddDependency(0, 2);	// input -> physics
+	frame.AddDependency(1, 3);	// ai -> animation
+	frame.AddDependency(2, 5);	// physics -> transforms
+	frame.AddDependency(3, 5);	// animation -> transforms
+	frame.AddDependency(5, 6);	// transforms -> culling
+	frame.AddDependency(6, 7);	// culling -> render
+	frame.AddDependency(4, 7);	// audio -> render
+
+	DagRunStats stats;
+	bool ok = run_task_graph(frame, 4, &stats);
+	printf("ran: %d\n", ok);
+	for (int i = 0; i < numSystems; i++)
+		printf("  %-10s finished #%d\n", names[i], finishedAt[i]);
+	printf("%d threads, parallelism %.2f, idle %.2f ms of %.2f ms, %d steals\n", stats.numThreads,
+		stats.parallelism, stats.idleMs, stats.numThreads * stats.wallMs, stats.numSteals);
+
+	frame.AddDependency(7, 0);
+	printf("with render -> input: ran %d\n", run_task_graph(frame, 4, &stats));
+
+	TaskGraph failing;
+	std::atomic<int> numRun(0);
+	for (int i = 0; i < 100; i++)
+		failing.AddTask([&, i]() { if (i == 10) throw std::runtime_error("task 10 failed"); numRun++; });
+	for (int i = 1; i < 100; i++)
+		failing.AddDependency(i - 1, i);
+	try
+	{
+		run_task_graph(failing, 4, &stats);
+	}
+	catch (const std::exception& e)
+	{
+		printf("rethrown: %s, %d tasks ran\n", e.what(), numRun.load());
+	}
+}
+
+// 10^4-ish small tasks on a random DAG
+static BenchBody bench_dag_executor(int n, std::mt19937& rng)
+{
+	std::shared_ptr<TaskGraph> graph(new TaskGraph());
+	for (int i = 0; i < n; i++)
+		graph->AddTask([]() { spin(2000); });
+
+	std::vector<std::pair<int, int>> edges = random_dag_edges(n, 2 * n, rng);
+	for (size_t e = 0; e < edges.size(); e++)
+		graph->AddDependency(edges[e].first, edges[e].second);
+
+	return [graph]()
+	{
+		DagRunStats stats;
+		run_task_graph(*graph, 0, &stats);
+		bench_consume((long long)stats.parallelism);
+	};
+}
+
+REGISTER_BENCHMARK(dag_executor, bench_dag_executor, 10000, 1000000);
@@ -0,0 +1,230 @@
+#include <stdio.h>
+#include <assert.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "benchmark.h"
+
+// Topological order kept up to date as edges come and go (Pearce & Kelly). An edge
+// u -> v with ord(u) < ord(v) changes nothing. Otherwise only the vertices between
+// ord(v) and ord(u) can be affected: those reachable from v (forward) and those
+// reaching u (backward), found by searches that never leave that window. The
+// backward set then takes the lowest of the freed positions and the forward set the
+// rest, each in its old relative order. Removing an edge never invalidates an order.
+struct DynamicTopOrder
+{
+	std::vector<std::vector<int>> m_out;
+	std::vector<std::vector<int>> m_in;
+	std::vector<int> m_ord;			// position of each vertex
+	std::vector<int> m_vertexAt;	// vertex at each position
+
+	// search scratch, kept between calls
+	std::vector<int> m_mark;		// == m_stamp when visited by the current search
+	std::vector<int> m_parent;
+	int m_stamp = 0;
+	std::vector<int> m_stack;
+	std::vector<int> m_forward;
+	std::vector<int> m_backward;
+	std::vector<int> m_slots;
+
+	void Reset(int numVertices)
+	{
+		m_out.assign(numVertices, std::vector<int>());
+		m_in.assign(numVertices, std::vector<int>());
+		m_ord.resize(numVertices);
+		m_vertexAt.resize(numVertices);
+		for (int v = 0; v < numVertices; v++)
+			m_ord[v] = m_vertexAt[v] = v;
+		m_mark.assign(numVertices, 0);
+		m_parent.assign(numVertices, -1);
+		m_stamp = 0;
+	}
+
+	int NumVertices() const { return (int)m_ord.size(); }
+
+	int AddVertex()
+	{
+		const int v = NumVertices();
+		m_out.push_back(std::vector<int>());
+		m_in.push_back(std::vector<int>());
+		m_ord.push_back(v);
+		m_vertexAt.push_back(v);
+		m_mark.push_back(0);
+		m_parent.push_back(-1);
+		return v;
+	}
+
+	// Inserts u -> v unless it would close a cycle; then nothing changes and, if
+	// cycle is given, it gets the vertices of one cycle the edge would create,
+	// starting and ending with u.
+	bool AddEdge(int u, int v, std::vector<int>* cycle = nullptr)
+	{
+		assert(u >= 0 && u < NumVertices() && v >= 0 && v < NumVertices());
+		if (u == v)
+		{
+			if (cycle)
+				cycle->assign(2, u);
+			return false;
+		}
+
+		const int lb = m_ord[v];
+		const int ub = m_ord[u];
+		if (lb < ub)
+		{
+			// forward: everything v reaches without passing position ub
+			m_forward.clear();
+			if (!Search(v, ub, true, u, &m_forward))
+			{
+				if (cycle)
+				{
+					cycle->clear();
+					cycle->push_back(u);
+					for (int w = u; w != v; w = m_parent[w])
+						cycle->push_back(m_parent[w]);
+					std::reverse(cycle->begin() + 1, cycle->end());
+					cycle->push_back(u);
+				}
+				return false;
+			}
+
+			// backward: everything reaching u from position lb or later
+			m_backward.clear();
+			Search(u, lb, false, -1, &m_backward);
+			Reorder();
+		}
+
+		m_out[u].push_back(v);
+		m_in[v].push_back(u);
+		return true;
+	}
+
+	// removes one u -> v edge; the order stays valid as it is
+	bool RemoveEdge(int u, int v)
+	{
+		std::vector<int>::iterator it = std::find(m_out[u].begin(), m_out[u].end(), v);
+		if (it == m_out[u].end())
+			return false;
+		*it = m_out[u].back();
+		m_out[u].pop_back();
+
+		it = std::find(m_in[v].begin(), m_in[v].end(), u);
+		*it = m_in[v].back();
+		m_in[v].pop_back();
+		return true;
+	}
+
+	// vertices in topological order
+	const std::vector<int>& Order() const { return m_vertexAt; }
+
+private:
+	// Iterative DFS from start over out-edges (forward) or in-edges, staying at
+	// positions <= bound (forward) or >= bound (backward). Returns false as soon as
+	// target is reached.
+	bool Search(int start, int bound, bool forward, int target, std::vector<int>* visited)
+	{
+		m_stamp++;
+		m_stack.clear();
+		m_stack.push_back(start);
+		m_mark[start] = m_stamp;
+		m_parent[start] = -1;
+		while (!m_stack.empty())
+		{
+			const int x = m_stack.back();
+			m_stack.pop_back();
+			visited->push_back(x);
+
+			const std::vector<int>& next = forward ? m_out[x] : m_in[x];
+			for (size_t i = 0; i < next.size(); i++)
+			{
+				const int y = next[i];
+				if (m_mark[y] == m_stamp)
+					continue;
+				if (forward ? m_ord[y] > bound : m_ord[y] < bound)
+					continue;
+
+				m_mark[y] = m_stamp;
+				m_parent[y] = x;
+				if (y == target)
+					return false;
+				m_stack.push_back(y);
+			}
+		}
+		return true;
+	}
+
+	void Reorder()
+	{
+		const std::vector<int>& ord = m_ord;
+		auto byOrder = [&ord](int a, int b) { return ord[a] < ord[b]; };
+		std::sort(m_backward.begin(), m_backward.end(), byOrder);
+		std::sort(m_forward.begin(), m_forward.end(), byOrder);
+
+		m_slots.clear();
+		for (size_t i = 0; i < m_backward.size(); i++)
+			m_slots.push_back(m_ord[m_backward[i]]);
+		for (size_t i = 0; i < m_forward.size(); i++)
+			m_slots.push_back(m_ord[m_forward[i]]);
+		std::sort(m_slots.begin(), m_slots.end());
+
+		size_t k = 0;
+		for (size_t i = 0; i < m_backward.size(); i++, k++)
+		{
+			m_ord[m_backward[i]] = m_slots[k];
+			m_vertexAt[m_slots[k]] = m_backward[i];
+		}
+		for (size_t i = 0; i < m_forward.size(); i++, k++)
+		{
+			m_ord[m_forward[i]] = m_slots[k];
+			m_vertexAt[m_slots[k]] = m_forward[i];
+		}
+	}
+};
+
+static void print_order(const DynamicTopOrder& dag)
+{
+	printf("{");
+	for (size_t i = 0; i < dag.Order().size(); i++)
+		printf(" %d", dag.Order()[i]);
+	printf(" }\n");
+}
+
+void test_dynamic_top_sort()
+{
+	DynamicTopOrder dag;
+	dag.Reset(5);
+	dag.AddEdge(0, 1);
+	dag.AddEdge(3, 2);	// 3 moves ahead of 2
+	dag.AddEdge(4, 0);	// 4 moves ahead of 0 and everything after it that 0 reaches
+	print_order(dag);
+
+	std::vector<int> cycle;
+	bool ok = dag.AddEdge(1, 4, &cycle);
+	printf("add 1 -> 4: %d, cycle:", ok);
+	for (size_t i = 0; i < cycle.size(); i++)
+		printf(" %d", cycle[i]);
+	printf("\n");
+
+	dag.RemoveEdge(4, 0);
+	ok = dag.AddEdge(1, 4);
+	printf("after removing 4 -> 0, add 1 -> 4: %d ", ok);
+	print_order(dag);
+}
+
+// edges of a random DAG inserted in random order, so most of them force a reorder
+static BenchBody bench_dynamic_top_sort(int n, std::mt19937& rng)
+{
+	std::vector<std::pair<int, int>> edges = random_dag_edges(n, 4 * n, rng);
+	std::shuffle(edges.begin(), edges.end(), rng);
+	return [n, edges]()
+	{
+		DynamicTopOrder dag;
+		dag.Reset(n);
+		int accepted = 0;
+		for (size_t e = 0; e < edges.size(); e++)
+			accepted += dag.AddEdge(edges[e].first, edges[e].second) ? 1 : 0;
+		bench_consume(accepted);
+	};
+}
+
+REGISTER_BENCHMARK(dynamic_top_sort, bench_dynamic_top_sort, 10000, 1000000);
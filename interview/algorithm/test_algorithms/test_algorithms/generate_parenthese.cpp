@@ -1,12 +1,11 @@
 #include <stdio.h>
 #include <assert.h>
 
-// 0 means left parenthesis, 1 means right parenthesis
+#include "backtrack.h"
+#include "benchmark.h"
+#include "output_sink.h"
 
-static bool is_a_solution(int a[], int k, int n)
-{
-	return k == n;
-}
+// 0 means left parenthesis, 1 means right parenthesis
 
 static int construct_candidates(const int a[], int k, int n, int c[])
 {
@@ -56,54 +55,92 @@ static int construct_candidates(const int a[], int k, int n, int c[])
 	return ncandidates;
 }
 
-static void process_solution(int a[], int k)
+struct ParenthesesCandidates
 {
-	printf("{");
-	for (int i = 0; i < k; i++)
-		if (a[i] == 0)
-			printf(" (");
-		else if (a[i] == 1)
-			printf(")");
-		else
-			assert(false);
+	typedef int Value;
+	enum { kMaxCandidates = 2 };
 
-	printf(" }\n");
-}
+	int m_n;
 
-static void backtrack(int a[], int k, int n)
-{
-	static const int MAX_CANDIDATES = 2;
-	int c[MAX_CANDIDATES];
+	int MaxDepth() const { return m_n; }
 
-	if (is_a_solution(a, k, n))
+	bool IsSolution(const int a[], int k) const
 	{
-		process_solution(a, k);
+		return k == m_n;
 	}
-	else
+
+	int Construct(const int a[], int k, int c[]) const
 	{
-		int ncandidates = construct_candidates(a, k, n, c);
-		assert(ncandidates <= MAX_CANDIDATES);
+		return construct_candidates(a, k, m_n, c);
+	}
+};
 
-		for (int i = 0; i < ncandidates; i++)
-		{
-			a[k] = c[i];
-			//make_move(a, k, input);
-			backtrack(a, k + 1, n);
-			//unmake_move(a, k, input);
-		}
+struct PrintParentheses
+{
+	bool operator()(const int a[], int k)
+	{
+		printf("{");
+		for (int i = 0; i < k; i++)
+			if (a[i] == 0)
+				printf(" (");
+			else if (a[i] == 1)
+				printf(")");
+			else
+				assert(false);
+
+		printf(" }\n");
+		return true;
 	}
+};
+
+template <typename Visitor>
+static void generate_parentheses(int n, Visitor& visitor)
+{
+	assert(n % 2 == 0);
+	ParenthesesCandidates candidates = { n };
+	backtrack_search(candidates, NoPrune(), visitor);
 }
 
 static void generate_parentheses(int n)
 {
-	assert(n < 64);
-	int a[64];
-
-	assert(n % 2 == 0);
-	backtrack(a, 0, n);
+	PrintParentheses print;
+	generate_parentheses(n, print);
 }
 
 void test_generate_parentheses()
 {
 	generate_parentheses(8);
-}
\ No newline at end of file
+
+	MemorySink memory;
+	TextWriter<MemorySink> text(memory, "()");
+	generate_parentheses(6, text);
+	printf("%.*s", (int)memory.m_used, memory.m_data.data());
+}
+
+// n is the string length; odd sizes round down to whole pairs
+static BenchBody bench_generate_parentheses(int n, std::mt19937&)
+{
+	const int len = n & ~1;
+	return [len]() { generate_parentheses(len); };
+}
+
+// the same enumeration through a FileSink, one "(()())" line per solution
+static BenchBody bench_parentheses_text_file(int n, std::mt19937&)
+{
+	const int len = n & ~1;
+	const std::string path = bench_temp_path("parentheses_text_file");
+	return [len, path]()
+	{
+		FileSink file;
+		if (file.Open(path.c_str()))
+		{
+			TextWriter<FileSink> text(file, "()");
+			generate_parentheses(len, text);
+		}
+		file.Close();
+		remove(path.c_str());
+	};
+}
+
+REGISTER_BENCHMARK(generate_parentheses, bench_generate_parentheses, 16, 24);
+REGISTER_BENCHMARK(parentheses_text_file, bench_parentheses_text_file, 24, 32);
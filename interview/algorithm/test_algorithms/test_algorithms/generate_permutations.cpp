@@ -2,12 +2,17 @@
 #include <string.h>
 #include <assert.h>
 
-static bool is_a_solution(int a[], int k, int n)
-{
-	return k == n;
-}
+#include <stdlib.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "backtrack.h"
+#include "benchmark.h"
+#include "output_sink.h"
+#include "parallel.h"
 
-static int construct_candidates(int a[], int k, int n, int c[])
+static int construct_candidates(const int a[], int k, int n, int c[])
 {
 	int ncandidates = 0;
 
@@ -30,46 +35,389 @@ static int construct_candidates(int a[], int k, int n, int c[])
 	return ncandidates;
 }
 
-static void process_solution(const int a[], int k)
+struct PermutationCandidates
+{
+	typedef int Value;
+	enum { kMaxCandidates = 64 };
+
+	int m_n;
+
+	int MaxDepth() const { return m_n; }
+
+	bool IsSolution(const int a[], int k) const
+	{
+		return k == m_n;
+	}
+
+	int Construct(const int a[], int k, int c[]) const
+	{
+		return construct_candidates(a, k, m_n, c);
+	}
+};
+
+struct PrintPermutation
+{
+	bool operator()(const int a[], int k)
+	{
+		for (int i = 0; i < k; i++)
+			printf(" %d", a[i]);
+		printf("\n");
+		return true;
+	}
+};
+
+template <typename Visitor>
+static void generate_permutations(int n, Visitor& visitor)
+{
+	assert(n < 64);
+	PermutationCandidates candidates = { n };
+	backtrack_search(candidates, NoPrune(), visitor);
+}
+
+static void generate_permutations(int n)
 {
-	for (int i = 0; i < k; i++)
-		printf(" %d", a[i]);
-	printf("\n");
+	PrintPermutation print;
+	generate_permutations(n, print);
 }
 
-static void backtrack(int a[], int k, int n)
+// Permutations of 0..n-1 by lexicographic rank. unrank builds the permutation from
+// its Lehmer code (digit i = how many unused values are smaller than a[i], in the
+// factorial base), rank goes back; both O(n^2), which is nothing for n <= 20, the
+// most whose n! fits 64 bits. Between ranks std::next_permutation steps in O(1)
+// amortized, so any rank range [begin, end) is enumerable on its own.
+static const int kMaxRankedPermutation = 20;
+
+static unsigned long long factorial(int n)
 {
-	static const int MAX_CANDIDATES = 64;
-	int c[MAX_CANDIDATES];
+	assert(n <= kMaxRankedPermutation);
+	unsigned long long f = 1;
+	for (int i = 2; i <= n; i++)
+		f *= i;
+	return f;
+}
 
-	if (is_a_solution(a, k, n))
+static void permutation_unrank(int n, unsigned long long rank, int a[])
+{
+	assert(n <= kMaxRankedPermutation && rank < factorial(n));
+	bool used[kMaxRankedPermutation] = {};
+	for (int i = 0; i < n; i++)
 	{
-		process_solution(a, k);
+		const unsigned long long f = factorial(n - 1 - i);
+		int digit = (int)(rank / f);
+		rank %= f;
+
+		int v = 0;
+		while (used[v] || digit > 0)
+		{
+			if (!used[v])
+				digit--;
+			v++;
+		}
+		used[v] = true;
+		a[i] = v;
 	}
-	else
+}
+
+static unsigned long long permutation_rank(const int a[], int n)
+{
+	assert(n <= kMaxRankedPermutation);
+	unsigned long long rank = 0;
+	for (int i = 0; i < n; i++)
+	{
+		int digit = 0;
+		for (int j = i + 1; j < n; j++)
+			digit += a[j] < a[i] ? 1 : 0;
+		rank += digit * factorial(n - 1 - i);
+	}
+	return rank;
+}
+
+// Calls visitor(a, n) for the permutations of rank [begin, end) in order, like a
+// backtrack.h visitor; false from the visitor stops early. Returns false if stopped.
+template <typename Visitor>
+static bool enumerate_permutations(int n, unsigned long long begin, unsigned long long end, Visitor& visitor)
+{
+	int a[kMaxRankedPermutation];
+	if (begin >= end)
+		return true;
+
+	permutation_unrank(n, begin, a);
+	for (unsigned long long r = begin; ; )
+	{
+		if (!visitor((const int*)a, n))
+			return false;
+		if (++r == end)
+			return true;
+		std::next_permutation(a, a + n);
+	}
+}
+
+// Passes solutions on to a worker's visitor, and every 4096 of them checks whether
+// another worker has stopped the search, so a cancelled chunk ends early.
+template <typename Visitor>
+struct CancellableVisitor
+{
+	Visitor& m_visitor;
+	CancelToken* m_token;
+	unsigned int m_count;
+
+	bool operator()(const int a[], int k)
 	{
-		int ncandidates = construct_candidates(a, k, n, c);
-		assert(ncandidates <= MAX_CANDIDATES);
+		if ((++m_count & 4095) == 0 && m_token->IsCancelled())
+			return false;
+		if (m_visitor(a, k))
+			return true;
+		m_token->Cancel();
+		return false;
+	}
+};
+
+// n! split into chunks of consecutive ranks on parallel_for, one visitor per worker.
+// The chunk count is capped at kPermutationChunksPerWorker per worker (enough for
+// uneven chunks to balance out), so the chunk size grows with n! and the count
+// always fits parallel_for's int. A visitor returning false cancels the token and
+// the other workers stop too, as in backtrack_parallel(). Returns false if the
+// enumeration was stopped.
+static const int kPermutationChunksPerWorker = 64;
+
+template <typename Visitor>
+static bool enumerate_permutations_parallel(int n, std::vector<Visitor>* visitors, CancelToken* token = nullptr)
+{
+	assert(!visitors->empty());
+	CancelToken localToken;
+	if (!token)
+		token = &localToken;
+
+	const unsigned long long total = factorial(n);
+	const unsigned long long maxChunks = (unsigned long long)kPermutationChunksPerWorker * visitors->size();
+	const unsigned long long numChunks = std::min(total, maxChunks);
+	const unsigned long long chunkSize = (total + numChunks - 1) / numChunks;
+	parallel_for((int)numChunks, (int)visitors->size(), [&](int chunk, int worker)
+	{
+		if (token->IsCancelled())
+			return;
+
+		const unsigned long long begin = chunk * chunkSize;
+		if (begin >= total)
+			return;
+		CancellableVisitor<Visitor> visitor = { (*visitors)[worker], token, 0 };
+		enumerate_permutations(n, begin, std::min(begin + chunkSize, total), visitor);
+	});
+	return !token->IsCancelled();
+}
 
-		for (int i = 0; i < ncandidates; i++)
+// n queens as a constrained permutation: a[k] is the column of the queen in row k,
+// and a new queen must not share a diagonal with the earlier ones
+struct QueensPrune
+{
+	bool operator()(const int a[], int k) const
+	{
+		const int row = k - 1;
+		for (int i = 0; i < row; i++)
 		{
-			a[k] = c[i];
-			//make_move(a, k, input);
-			backtrack(a, k + 1, n);
-			//unmake_move(a, k, input);
+			if (abs(a[i] - a[row]) == row - i)
+				return false;
 		}
+		return true;
 	}
-}
+};
 
-static void generate_permutations(int n)
+struct CountSolutions
 {
-	assert(n < 64);
-	int a[64];
+	long long m_count;
+
+	bool operator()(const int[], int)
+	{
+		m_count++;
+		return true;
+	}
+};
+
+// stops the whole search at the first solution
+struct FirstSolution
+{
+	std::vector<int> m_solution;
+
+	bool operator()(const int a[], int k)
+	{
+		m_solution.assign(a, a + k);
+		return false;
+	}
+};
+
+static long long count_queens(int n, int numThreads)
+{
+	PermutationCandidates candidates = { n };
+	CountSolutions zero = { 0 };
+	std::vector<CountSolutions> counts(numThreads, zero);
+	backtrack_parallel(candidates, QueensPrune(), &counts, 3);
 
-	backtrack(a, 0, n);
+	long long total = 0;
+	for (size_t i = 0; i < counts.size(); i++)
+		total += counts[i].m_count;
+	return total;
 }
 
 void test_generate_permutations()
 {
 	generate_permutations(4);
-}
\ No newline at end of file
+
+	PermutationCandidates queens = { 8 };
+	CountSolutions serial = { 0 };
+	backtrack_search(queens, QueensPrune(), serial);
+	printf("8 queens: %lld serial, %lld parallel\n", serial.m_count, count_queens(8, 4));
+
+	int perm[kMaxRankedPermutation];
+	permutation_unrank(4, 9, perm);
+	printf("rank 9 of 4!: %d %d %d %d, ranked back: %llu\n", perm[0], perm[1], perm[2], perm[3], permutation_rank(perm, 4));
+	PrintPermutation print;
+	printf("ranks [20, 24):\n");
+	enumerate_permutations(4, 20, 24, print);
+
+	CountSolutions none = { 0 };
+	std::vector<CountSolutions> perWorker(4, none);
+	bool completed = enumerate_permutations_parallel(9, &perWorker);
+	long long total = 0;
+	for (size_t i = 0; i < perWorker.size(); i++)
+		total += perWorker[i].m_count;
+	printf("9! in parallel: %lld (completed %d)\n", total, completed);
+
+	// 18! is far too many to visit, but the first visitor to stop ends the search
+	std::vector<FirstSolution> stopAt(4);
+	completed = enumerate_permutations_parallel(18, &stopAt);
+	printf("18! stopped at a first permutation: completed %d\n", completed);
+
+	std::vector<FirstSolution> first(4);
+	CancelToken token;
+	completed = backtrack_parallel(queens, QueensPrune(), &first, 2, &token);
+	for (size_t i = 0; i < first.size(); i++)
+	{
+		if (first[i].m_solution.empty())
+			continue;
+		printf("first found (completed %d):", completed);
+		for (size_t k = 0; k < first[i].m_solution.size(); k++)
+			printf(" %d", first[i].m_solution[k]);
+		printf("\n");
+		break;
+	}
+}
+
+static BenchBody bench_generate_permutations(int n, std::mt19937&)
+{
+	return [n]() { generate_permutations(n); };
+}
+
+static BenchBody bench_queens_serial(int n, std::mt19937&)
+{
+	return [n]()
+	{
+		PermutationCandidates candidates = { n };
+		CountSolutions count = { 0 };
+		backtrack_search(candidates, QueensPrune(), count);
+		bench_consume(count.m_count);
+	};
+}
+
+static BenchBody bench_queens_parallel(int n, std::mt19937&)
+{
+	return [n]() { bench_consume(count_queens(n, default_num_threads())); };
+}
+
+// visits every permutation without output, the cost of the enumeration itself
+struct PermutationChecksum
+{
+	long long m_sum;
+
+	bool operator()(const int a[], int n)
+	{
+		m_sum += a[0] + a[n - 1];
+		return true;
+	}
+};
+
+static BenchBody bench_permutations_ranked(int n, std::mt19937&)
+{
+	return [n]()
+	{
+		PermutationChecksum sum = { 0 };
+		enumerate_permutations(n, 0, factorial(n), sum);
+		bench_consume(sum.m_sum);
+	};
+}
+
+static BenchBody bench_permutations_parallel(int n, std::mt19937&)
+{
+	return [n]()
+	{
+		PermutationChecksum zero = { 0 };
+		std::vector<PermutationChecksum> sums(default_num_threads(), zero);
+		enumerate_permutations_parallel(n, &sums);
+		for (size_t i = 0; i < sums.size(); i++)
+			bench_consume(sums[i].m_sum);
+	};
+}
+
+// all n! permutations to a file: text lines, n-byte records, and n-byte records
+// into a mapping; the ranked enumeration feeds the sinks faster than backtracking
+template <typename Sink>
+static void write_permutations(int n, Sink& sink, bool binary)
+{
+	if (binary)
+	{
+		BinaryWriter<Sink> records(sink, n);
+		enumerate_permutations(n, 0, factorial(n), records);
+	}
+	else
+	{
+		TextWriter<Sink> text(sink);
+		enumerate_permutations(n, 0, factorial(n), text);
+	}
+}
+
+static BenchBody bench_permutations_text_file(int n, std::mt19937&)
+{
+	const std::string path = bench_temp_path("permutations_text_file");
+	return [n, path]()
+	{
+		FileSink file;
+		if (file.Open(path.c_str()))
+			write_permutations(n, file, false);
+		file.Close();
+		remove(path.c_str());
+	};
+}
+
+static BenchBody bench_permutations_binary_file(int n, std::mt19937&)
+{
+	const std::string path = bench_temp_path("permutations_binary_file");
+	return [n, path]()
+	{
+		FileSink file;
+		if (file.Open(path.c_str()))
+			write_permutations(n, file, true);
+		file.Close();
+		remove(path.c_str());
+	};
+}
+
+static BenchBody bench_permutations_mapped_file(int n, std::mt19937&)
+{
+	const std::string path = bench_temp_path("permutations_mapped_file");
+	return [n, path]()
+	{
+		MappedSink file;
+		if (file.Open(path.c_str()))
+			write_permutations(n, file, true);
+		file.Close();
+		remove(path.c_str());
+	};
+}
+
+REGISTER_BENCHMARK(generate_permutations, bench_generate_permutations, 8, 10);
+REGISTER_BENCHMARK(permutations_text_file, bench_permutations_text_file, 10, 12);
+REGISTER_BENCHMARK(permutations_binary_file, bench_permutations_binary_file, 10, 12);
+REGISTER_BENCHMARK(permutations_mapped_file, bench_permutations_mapped_file, 10, 12);
+REGISTER_BENCHMARK(permutations_ranked, bench_permutations_ranked, 10, 14);
+REGISTER_BENCHMARK(permutations_parallel, bench_permutations_parallel, 10, 16);
+REGISTER_BENCHMARK(queens_serial, bench_queens_serial, 11, 16);
+REGISTER_BENCHMARK(queens_parallel, bench_queens_parallel, 11, 16);
@@ -1,67 +1,345 @@
 #include <stdio.h>
 #include <assert.h>
+#include <stdint.h>
 
-static bool finished = false;
+#include <vector>
 
-static bool is_a_solution(int a[], int k, int n)
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "backtrack.h"
+#include "benchmark.h"
+
+// a[k] says whether element k is in the subset
+struct SubsetCandidates
 {
-	return k == n;
+	typedef int Value;
+	enum { kMaxCandidates = 2 };
+
+	int m_n;
+
+	int MaxDepth() const { return m_n; }
+
+	bool IsSolution(const int a[], int k) const
+	{
+		return k == m_n;
+	}
+
+	int Construct(const int a[], int k, int c[]) const
+	{
+		c[0] = true;
+		c[1] = false;
+		return 2;
+	}
+};
+
+struct PrintSubset
+{
+	bool operator()(const int a[], int k)
+	{
+		printf("{");
+		for (int i = 0; i < k; i++)
+			if (a[i])
+				printf(" %d", i);
+
+		printf(" }\n");
+		return true;
+	}
+};
+
+// visitor gets the n in/out flags of each subset, e.g. a TextWriter with "01"
+template <typename Visitor>
+static void generate_subsets(int n, Visitor& visitor)
+{
+	SubsetCandidates candidates = { n };
+	backtrack_search(candidates, NoPrune(), visitor);
 }
 
-static void construct_candidates(int a[], int k, int n, int c[], int* ncandidates)
+static void generate_subsets(int n)
 {
-	c[0] = true;
-	c[1] = false;
-	*ncandidates = 2;
+	PrintSubset print;
+	generate_subsets(n, print);
 }
 
-static void process_solution(int a[], int k)
+static inline int lowest_bit(uint64_t x)
 {
-	printf("{");
-	for (int i = 0; i < k; i++)
-		if (a[i])
-			printf(" %d", i);
+	assert(x != 0);
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, x);
+	return (int)index;
+#else
+	return __builtin_ctzll(x);
+#endif
+}
 
-	printf(" }\n");
+// Subsets of n < 64 elements as bitmasks in Gray-code order: step i flips the
+// lowest set bit of i, so each subset differs from the previous one by one element
+// and the visitor can update a running value in O(1). visitor(mask, flipped) gets
+// flipped = -1 for the first, empty set; false stops the walk.
+template <typename Visitor>
+static bool gray_subsets(int n, Visitor& visitor)
+{
+	assert(n < 64);
+	uint64_t mask = 0;
+	if (!visitor(mask, -1))
+		return false;
+
+	const uint64_t count = (uint64_t)1 << n;
+	for (uint64_t i = 1; i < count; i++)
+	{
+		const int bit = lowest_bit(i);
+		mask ^= (uint64_t)1 << bit;
+		if (!visitor(mask, bit))
+			return false;
+	}
+	return true;
+}
+
+// Gray subsets [first, first + count) written to masks; the i-th Gray code is
+// i ^ (i >> 1), so batches are independent and can be split across threads.
+// Returns the number written, fewer at the end of the 2^n sequence.
+static int gray_subsets_batch(int n, uint64_t first, uint64_t* masks, int count)
+{
+	assert(n < 64);
+	const uint64_t total = (uint64_t)1 << n;
+	int written = 0;
+	for (uint64_t i = first; i < total && written < count; i++)
+		masks[written++] = i ^ (i >> 1);
+	return written;
 }
 
-static void backtrack(int a[], int k, int n)
+// A set over any number of elements, for universes past one machine word.
+struct DynamicBitset
+{
+	std::vector<uint64_t> m_words;
+
+	void Resize(int n) { m_words.assign((n + 63) / 64, 0); }
+	bool Test(int i) const { return (m_words[i / 64] >> (i % 64)) & 1; }
+	void Set(int i) { m_words[i / 64] |= (uint64_t)1 << (i % 64); }
+	void Reset(int i) { m_words[i / 64] &= ~((uint64_t)1 << (i % 64)); }
+};
+
+// The t-combinations of n elements in revolving-door order (Knuth, TAOCP 7.2.1.3,
+// Algorithm R): each step swaps exactly one element out and one in, reported by
+// Next(), so a caller keeps its own set (a word, a DynamicBitset, running sums) in
+// O(1) per step for any n. For n <= 64 the iterator also keeps the mask itself.
+struct RevolvingDoor
 {
-	static const int MAX_CANDIDATES = 2;
-	int c[MAX_CANDIDATES];
-	int ncandidates;
+	int m_n;
+	int m_t;
+	std::vector<int> m_c;	// m_c[1..t] the elements in increasing order, m_c[t + 1] = n
+	uint64_t m_mask;		// valid when m_n <= 64
+	bool m_done;
 
-	if (is_a_solution(a, k, n))
+	void Reset(int n, int t)
 	{
-		process_solution(a, k);
+		assert(t >= 0 && t <= n);
+		m_n = n;
+		m_t = t;
+		m_c.assign(t + 2, 0);
+		m_mask = 0;
+		for (int j = 1; j <= t; j++)
+		{
+			m_c[j] = j - 1;
+			if (n <= 64)
+				m_mask |= (uint64_t)1 << (j - 1);
+		}
+		m_c[t + 1] = n;
+		m_done = false;
 	}
-	else
+
+	// moves to the next combination; false when there is none
+	bool Next(int* out, int* in)
 	{
-		construct_candidates(a, k, n, c, &ncandidates);
-		assert(ncandidates <= MAX_CANDIDATES);
+		if (m_done || m_t == 0 || m_t == m_n)
+		{
+			m_done = true;
+			return false;
+		}
+
+		// R3: the easy case moves c[1] only
+		std::vector<int>& c = m_c;
+		const bool odd = m_t % 2 == 1;
+		if (odd && c[1] + 1 < c[2])
+			return Changed(1, c[1], c[1] + 1, out, in);
+		if (!odd && c[1] > 0)
+			return Changed(1, c[1], c[1] - 1, out, in);
 
-		for (int i = 0; i < ncandidates; i++)
+		// R4 / R5 alternate from j = 2, starting with R4 for odd t
+		bool decrease = odd;
+		for (int j = 2; j <= m_t; j++, decrease = !decrease)
 		{
-			a[k] = c[i];
-			//make_move(a, k, input);
-			backtrack(a, k + 1, n);
-			//unmake_move(a, k, input);
+			if (decrease && c[j] >= j)
+			{
+				const int removed = c[j];
+				c[j] = c[j - 1];
+				return Changed(j - 1, removed, j - 2, out, in);
+			}
+			if (!decrease && c[j] + 1 < c[j + 1])
+			{
+				const int removed = c[j - 1];
+				c[j - 1] = c[j];
+				return Changed(j, removed, c[j] + 1, out, in);
+			}
+		}
+
+		m_done = true;
+		return false;
+	}
 
-			if (finished) // terminate early
-				return;
+	// next masks into a caller buffer, n <= 64; the current one is not repeated
+	int NextBatch(uint64_t* masks, int count)
+	{
+		assert(m_n <= 64);
+		int written = 0;
+		int out, in;
+		while (written < count && Next(&out, &in))
+			masks[written++] = m_mask;
+		return written;
+	}
+
+private:
+	// element removed leaves, added takes its place in c[j]
+	bool Changed(int j, int removed, int added, int* out, int* in)
+	{
+		m_c[j] = added;
+		if (m_n <= 64)
+			m_mask ^= ((uint64_t)1 << removed) | ((uint64_t)1 << added);
+		*out = removed;
+		*in = added;
+		return true;
+	}
+};
+
+// best feature subset under a cost budget, value and cost updated per flipped bit
+struct BestSubset
+{
+	const int* m_value;
+	const int* m_cost;
+	int m_budget;
+	int m_sumValue;
+	int m_sumCost;
+	int m_best;
+	uint64_t m_bestMask;
+
+	bool operator()(uint64_t mask, int flipped)
+	{
+		if (flipped >= 0)
+		{
+			const int sign = (mask >> flipped) & 1 ? 1 : -1;
+			m_sumValue += sign * m_value[flipped];
+			m_sumCost += sign * m_cost[flipped];
 		}
+		if (m_sumCost <= m_budget && m_sumValue > m_best)
+		{
+			m_best = m_sumValue;
+			m_bestMask = mask;
+		}
+		return true;
+	}
+};
+
+void test_generate_subsets()
+{
+	generate_subsets(3);
+
+	int value[] = { 6, 5, 8, 9, 6, 7, 3 };
+	int cost[] = { 2, 3, 6, 7, 5, 9, 4 };
+	BestSubset best = { value, cost, 15, 0, 0, 0, 0 };
+	gray_subsets(7, best);
+	printf("best value %d under budget 15:", best.m_best);
+	for (int i = 0; i < 7; i++)
+		if ((best.m_bestMask >> i) & 1)
+			printf(" %d", i);
+	printf("\n");
+
+	uint64_t masks[8];
+	int numMasks = gray_subsets_batch(3, 0, masks, 8);
+	printf("gray order:");
+	for (int i = 0; i < numMasks; i++)
+		printf(" %d%d%d", (int)(masks[i] >> 2) & 1, (int)(masks[i] >> 1) & 1, (int)masks[i] & 1);
+	printf("\n");
+
+	RevolvingDoor door;
+	door.Reset(5, 3);
+	printf("revolving door 3 of 5: %02llx", (unsigned long long)door.m_mask);
+	numMasks = door.NextBatch(masks, 8);
+	for (int i = 0; i < numMasks; i++)
+		printf(" %02llx", (unsigned long long)masks[i]);
+	int out, in;
+	while (door.Next(&out, &in))
+		printf(" %02llx", (unsigned long long)door.m_mask);
+	printf("\n");
+
+	// pairs out of 100 features, past one word
+	DynamicBitset features;
+	features.Resize(100);
+	door.Reset(100, 2);
+	features.Set(0);
+	features.Set(1);
+	int steps = 1;
+	while (door.Next(&out, &in))
+	{
+		features.Reset(out);
+		features.Set(in);
+		steps++;
 	}
+	printf("pairs of 100: %d, last {%d, %d}\n", steps, door.m_c[1], door.m_c[2]);
 }
 
-static void generate_subsets(int n)
+static BenchBody bench_generate_subsets(int n, std::mt19937&)
 {
-	assert(n < 64);
-	int a[64];
-	
-	backtrack(a, 0, n);
+	return [n]() { generate_subsets(n); };
 }
 
-void test_generate_subsets()
+static BenchBody bench_gray_subsets(int n, std::mt19937& rng)
 {
-	generate_subsets(3);
-}
\ No newline at end of file
+	std::vector<int> value = random_ints(n, 1, 100, rng);
+	std::vector<int> cost = random_ints(n, 1, 100, rng);
+	return [n, value, cost]()
+	{
+		BestSubset best = { value.data(), cost.data(), 25 * n, 0, 0, 0, 0 };
+		gray_subsets(n, best);
+		bench_consume(best.m_best);
+	};
+}
+
+static BenchBody bench_gray_subsets_batch(int n, std::mt19937&)
+{
+	return [n]()
+	{
+		uint64_t masks[4096];
+		uint64_t acc = 0;
+		for (uint64_t first = 0; ; first += 4096)
+		{
+			int written = gray_subsets_batch(n, first, masks, 4096);
+			for (int i = 0; i < written; i++)
+				acc += masks[i];
+			if (written < 4096)
+				break;
+		}
+		bench_consume((long long)acc);
+	};
+}
+
+// 5-combinations of n
+static BenchBody bench_revolving_door(int n, std::mt19937&)
+{
+	return [n]()
+	{
+		RevolvingDoor door;
+		door.Reset(n, 5);
+		long long acc = 0;
+		int out, in;
+		while (door.Next(&out, &in))
+			acc += in - out;
+		bench_consume(acc);
+	};
+}
+
+REGISTER_BENCHMARK(generate_subsets, bench_generate_subsets, 16, 24);
+REGISTER_BENCHMARK(gray_subsets, bench_gray_subsets, 24, 40);
+REGISTER_BENCHMARK(gray_subsets_batch, bench_gray_subsets_batch, 24, 40);
+REGISTER_BENCHMARK(revolving_door, bench_revolving_door, 60, 200);
@@ -1,46 +1,244 @@
+#include <stdio.h>
+
 #include <algorithm>
+#include <vector>
 
-static void partition(const int s[], int n, int k)
-{
-#define MAXN 64
+#include "benchmark.h"
+#include "wavefront.h"
 
-	int m[MAXN][MAXN];	// DP table for values
-	int d[MAXN][MAXN];	// DP table for dividers
-	int p[MAXN];		// prefix sums array
+// m[i][j] is the smallest possible largest range when s[0..i] is split into j + 1
+// ranges, d[i][j] the end of the previous range in that split. m[i][j] reads
+// m[x][j - 1] for every x < i, all above and to the left, so the n x k tables are
+// filled by wavefront_for(); tiles are one column wide because k is usually small.
+static int partition(const int s[], int n, int k, std::vector<int>* dividers = nullptr, int numThreads = 0)
+{
+	if (n <= 0 || k <= 0)
+		return 0;
+	k = std::min(k, n);
 
+	std::vector<int> p(n + 1);	// prefix sums, p[i] = s[0] + ... + s[i - 1]
 	p[0] = 0;
-	for (int i = 1; i < n; i++)
-		p[i] = p[i - 1] + s[i];
-
 	for (int i = 0; i < n; i++)
-		m[i][0] = p[i];
+		p[i + 1] = p[i] + s[i];
+
+	std::vector<int> m((size_t)n * k);	// DP table for values
+	std::vector<int> d((size_t)n * k);	// DP table for dividers
+	wavefront_for(n, k, 64, 1, numThreads, [&](int i, int j)
+	{
+		if (j == 0 || i == 0)
+		{
+			m[(size_t)i * k + j] = p[i + 1];
+			d[(size_t)i * k + j] = -1;
+			return;
+		}
+
+		int best = 0x7FFFFFFF;
+		int bestX = -1;
+		for (int x = 0; x < i; x++)
+		{
+			int cost = std::max(m[(size_t)x * k + j - 1], p[i + 1] - p[x + 1]);
+			if (cost < best)
+			{
+				best = cost;
+				bestX = x;
+			}
+		}
+		m[(size_t)i * k + j] = best;
+		d[(size_t)i * k + j] = bestX;
+	});
+
+	if (dividers)
+	{
+		// each divider is the index of the last element of a range
+		dividers->clear();
+		for (int i = n - 1, j = k - 1; j > 0 && d[(size_t)i * k + j] >= 0; j--)
+		{
+			i = d[(size_t)i * k + j];
+			dividers->push_back(i);
+		}
+		std::reverse(dividers->begin(), dividers->end());
+	}
+	return m[(size_t)(n - 1) * k + k - 1];
+}
 
-	for (int j = 0; j < k; j++)
-		m[0][j] = s[0];
+// Can s be cut into at most k ranges of sum <= cap? Greedy: extend the current
+// range until the next item doesn't fit.
+static bool partition_fits(const int s[], int n, int k, long long cap)
+{
+	int ranges = 1;
+	long long sum = 0;
+	for (int i = 0; i < n; i++)
+	{
+		if (s[i] > cap)
+			return false;
+		if (sum + s[i] > cap)
+		{
+			if (++ranges > k)
+				return false;
+			sum = 0;
+		}
+		sum += s[i];
+	}
+	return true;
+}
 
-	for (int i = 1; i < n; i++)
+// Dividers for a cap that fits: greedy again, but a range is also closed once the
+// items left are just enough for one per remaining range, so there are exactly
+// min(k, n) ranges and no core is left idle.
+static void partition_place(const int s[], int n, int k, long long cap, std::vector<int>* dividers)
+{
+	dividers->clear();
+	int left = std::min(k, n);	// ranges still open, counting the current one
+	long long sum = 0;
+	for (int i = 0; i + 1 < n && left > 1; i++)
 	{
-		for (int j = 1; j < k; j++)
+		sum += s[i];
+		if (sum + s[i + 1] > cap || n - 1 - i == left - 1)
 		{
-			m[i][j] = 0x7FFFFFFF;
+			dividers->push_back(i);
+			sum = 0;
+			left--;
+		}
+	}
+}
+
+// Smallest cap that fits, by binary search between the largest item and the total:
+// O(n log sum) and O(1) extra memory beyond the dividers.
+static long long partition_greedy(const int s[], int n, int k, std::vector<int>* dividers = nullptr)
+{
+	if (n <= 0 || k <= 0)
+		return 0;
+
+	long long lo = 0;
+	long long hi = 0;
+	for (int i = 0; i < n; i++)
+	{
+		lo = std::max(lo, (long long)s[i]);
+		hi += s[i];
+	}
 
-			for (int x = 0; x < (i - 1); x++)
+	while (lo < hi)
+	{
+		long long mid = lo + (hi - lo) / 2;
+		if (partition_fits(s, n, k, mid))
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+
+	if (dividers)
+		partition_place(s, n, k, lo, dividers);
+	return lo;
+}
+
+// The partition() recurrence, one column at a time in O(n) memory. For a fixed i,
+// max(m[x][j - 1], p[i] - p[x]) is the max of a non-decreasing and a non-increasing
+// function of x, so it falls and then rises; its minimum only moves right as i
+// grows, so one pointer per column finds every minimum in O(n): O(k n) in total
+// instead of O(k n^2). The dividers come from partition_place() at the optimum.
+static long long partition_monotone(const int s[], int n, int k, std::vector<int>* dividers = nullptr)
+{
+	if (n <= 0 || k <= 0)
+		return 0;
+	k = std::min(k, n);
+
+	std::vector<long long> p(n + 1);	// p[i] = s[0] + ... + s[i - 1]
+	p[0] = 0;
+	for (int i = 0; i < n; i++)
+		p[i + 1] = p[i] + s[i];
+
+	std::vector<long long> prev(p.begin() + 1, p.end());	// m[i][0]
+	std::vector<long long> cur(n);
+	for (int j = 1; j < k; j++)
+	{
+		cur[0] = p[1];
+		int x = 0;
+		for (int i = 1; i < n; i++)
+		{
+			long long best = std::max(prev[x], p[i + 1] - p[x + 1]);
+			while (x + 1 < i)
 			{
-				int cost = std::max(m[x][j - 1], p[i] - p[x]);
-				if (m[x][j] > cost)
-				{
-					m[i][j] = cost;
-					d[i][j] = x;
-				}
+				long long next = std::max(prev[x + 1], p[i + 1] - p[x + 2]);
+				if (next > best)
+					break;
+				best = next;
+				x++;
 			}
+			cur[i] = best;
 		}
+		prev.swap(cur);
+	}
+
+	if (dividers)
+		partition_place(s, n, k, prev[n - 1], dividers);
+	return prev[n - 1];
+}
+
+static void print_ranges(const int seq[], int nseq, const std::vector<int>& dividers)
+{
+	for (int i = 0, r = 0; r <= (int)dividers.size(); r++)
+	{
+		int last = r < (int)dividers.size() ? dividers[r] : nseq - 1;
+		printf(" {");
+		for (; i <= last; i++)
+			printf(i < last ? "%d " : "%d", seq[i]);
+		printf("}");
 	}
+	printf("\n");
 }
 
 void test_linear_partition()
 {
-	//int seq[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
-	int seq[] = { 1, 2, 3, };
+	int seq[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
 	int nseq = sizeof(seq) / sizeof(seq[0]);
-	partition(seq, nseq, 2);
-}
\ No newline at end of file
+
+	std::vector<int> dividers;
+	int cost = partition(seq, nseq, 3, &dividers);
+	printf("largest range: %d, ranges:", cost);
+	print_ranges(seq, nseq, dividers);
+
+	long long greedy = partition_greedy(seq, nseq, 3, &dividers);
+	printf("greedy: %lld, ranges:", greedy);
+	print_ranges(seq, nseq, dividers);
+
+	long long monotone = partition_monotone(seq, nseq, 3, &dividers);
+	printf("monotone: %lld, ranges:", monotone);
+	print_ranges(seq, nseq, dividers);
+
+	// more ranges than the weights need still gives one range per core
+	int jobs[] = { 50, 1, 1, 1, 1, 1 };
+	partition_greedy(jobs, 6, 4, &dividers);
+	printf("greedy, 4 cores:");
+	print_ranges(jobs, 6, dividers);
+}
+
+static BenchBody bench_linear_partition(int n, std::mt19937& rng)
+{
+	std::vector<int> seq = random_ints(n, 1, 100, rng);
+	return [seq]() { bench_consume(partition(seq.data(), (int)seq.size(), 4)); };
+}
+
+// a job list split across 64 cores
+static BenchBody bench_partition_greedy(int n, std::mt19937& rng)
+{
+	std::vector<int> seq = random_ints(n, 1, 1000, rng);
+	return [seq]()
+	{
+		std::vector<int> dividers;
+		bench_consume(partition_greedy(seq.data(), (int)seq.size(), 64, &dividers));
+	};
+}
+
+static BenchBody bench_partition_monotone(int n, std::mt19937& rng)
+{
+	std::vector<int> seq = random_ints(n, 1, 1000, rng);
+	return [seq]()
+	{
+		std::vector<int> dividers;
+		bench_consume(partition_monotone(seq.data(), (int)seq.size(), 64, &dividers));
+	};
+}
+
+REGISTER_BENCHMARK(linear_partition, bench_linear_partition, 2000, 20000);
+REGISTER_BENCHMARK(partition_greedy, bench_partition_greedy, 1000000, 100000000);
+REGISTER_BENCHMARK(partition_monotone, bench_partition_monotone, 1000000, 10000000);
@@ -2,6 +2,11 @@
 #include <assert.h>
 #include <string.h>
 
+#include <algorithm>
+#include <vector>
+
+#include "benchmark.h"
+
 static int DP(const int* seq, const int nseq, int i, int* num_cached, int* prev_nodes)
 {
 	assert(i >= 0 && i < nseq);
@@ -45,10 +50,70 @@ static int solution(const int* seq, const int nseq)
 	int prev_nodes[64];
 	memset(num_cached, -1, sizeof(num_cached));
 	memset(prev_nodes, -1, sizeof(prev_nodes));
-	int num = DP(seq, nseq, nseq - 1, num_cached, prev_nodes);
+	int num = 0;
+	for (int i = 0; i < nseq; i++)
+		num = std::max(num, DP(seq, nseq, i, num_cached, prev_nodes));
 	return num;
 }
 
+// Patience sorting, O(n log n). tails[k] is the index of the smallest value that
+// ends an increasing subsequence of length k + 1; tails stay sorted by value, so
+// each element finds its pile by binary search and links to the top of the pile
+// before it. indices gets one longest subsequence, as positions in seq.
+static int lis_patience(const int* seq, int nseq, std::vector<int>* indices)
+{
+	std::vector<int> tails;
+	std::vector<int> prev(nseq);
+	for (int i = 0; i < nseq; i++)
+	{
+		// first pile whose top is >= seq[i]; strictly increasing like DP()
+		int lo = 0;
+		int hi = (int)tails.size();
+		while (lo < hi)
+		{
+			int mid = (lo + hi) / 2;
+			if (seq[tails[mid]] < seq[i])
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+
+		prev[i] = lo > 0 ? tails[lo - 1] : -1;
+		if (lo == (int)tails.size())
+			tails.push_back(i);
+		else
+			tails[lo] = i;
+	}
+
+	if (indices)
+	{
+		indices->resize(tails.size());
+		for (int k = (int)tails.size() - 1, i = tails.empty() ? -1 : tails.back(); k >= 0; k--, i = prev[i])
+			(*indices)[k] = i;
+	}
+	return (int)tails.size();
+}
+
+// Online LIS length over an unbounded stream: only the pile tops are kept, so
+// memory is O(LIS length) whatever the stream length. Tails() is the smallest
+// possible last value of an increasing subsequence of each length seen so far.
+struct LisStream
+{
+	std::vector<int> m_tails;
+
+	void Push(int value)
+	{
+		std::vector<int>::iterator it = std::lower_bound(m_tails.begin(), m_tails.end(), value);
+		if (it == m_tails.end())
+			m_tails.push_back(value);
+		else
+			*it = value;
+	}
+
+	int Length() const { return (int)m_tails.size(); }
+	const std::vector<int>& Tails() const { return m_tails; }
+};
+
 void test_longest_increasing_sequence()
 {
 	//int seq[] = { 2, 4, 3, 5, 1, 7, 6, 9, 8 };
@@ -58,4 +123,53 @@ void test_longest_increasing_sequence()
 	int nlen = sizeof(seq) / sizeof(seq[0]);
 	int val = solution(seq, nlen);
 	printf("val: %d\n", val);
-}
\ No newline at end of file
+
+	int trend[] = { 2, 4, 3, 5, 1, 7, 6, 9, 8 };
+	int ntrend = sizeof(trend) / sizeof(trend[0]);
+	std::vector<int> indices;
+	int len = lis_patience(trend, ntrend, &indices);
+	printf("patience: %d:", len);
+	for (size_t i = 0; i < indices.size(); i++)
+		printf(" %d", trend[indices[i]]);
+	printf("\n");
+
+	LisStream stream;
+	for (int i = 0; i < ntrend; i++)
+	{
+		stream.Push(trend[i]);
+		printf("after %d: length %d\n", trend[i], stream.Length());
+	}
+}
+
+static BenchBody bench_lis(int n, std::mt19937& rng)
+{
+	std::vector<int> seq = random_ints(n, 0, 1000000, rng);
+	return [seq]() { bench_consume(solution(seq.data(), (int)seq.size())); };
+}
+
+static BenchBody bench_lis_patience(int n, std::mt19937& rng)
+{
+	std::vector<int> seq = random_walk(n, 1000000, 100, rng);
+	return [seq]()
+	{
+		std::vector<int> indices;
+		bench_consume(lis_patience(seq.data(), (int)seq.size(), &indices));
+	};
+}
+
+static BenchBody bench_lis_stream(int n, std::mt19937& rng)
+{
+	std::vector<int> seq = random_walk(n, 1000000, 100, rng);
+	return [seq]()
+	{
+		LisStream stream;
+		for (size_t i = 0; i < seq.size(); i++)
+			stream.Push(seq[i]);
+		bench_consume(stream.Length());
+		bench_report_bytes(stream.m_tails.capacity() * sizeof(int));
+	};
+}
+
+REGISTER_BENCHMARK(lis, bench_lis, 64, 64);
+REGISTER_BENCHMARK(lis_patience, bench_lis_patience, 1000000, 100000000);
+REGISTER_BENCHMARK(lis_stream, bench_lis_stream, 1000000, 1000000000);
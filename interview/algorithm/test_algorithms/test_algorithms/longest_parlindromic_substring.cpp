@@ -2,6 +2,12 @@
 #include <stdio.h>
 #include <string.h>
 
+#include <algorithm>
+#include <vector>
+
+#include "benchmark.h"
+#include "wavefront.h"
+
 static int DP(const char* str, int nstr, int i, int j)
 {
 	assert(i < nstr && j < nstr);
@@ -9,7 +15,7 @@ static int DP(const char* str, int nstr, int i, int j)
 	if (i == j)
 		return 1;
 	else if (i == j - 1)
-		return 2;
+		return str[i] == str[j] ? 2 : 1;
 
 	int count[3];
 	count[0] = (str[i] == str[j] ? 2 : 0) + DP(str, nstr, i + 1, j - 1);
@@ -27,14 +33,178 @@ static int DP(const char* str, int nstr, int i, int j)
 	return max_count;
 }
 
+// DP(i, j) bottom-up on an n x n table. (i, j) reads (i + 1, j - 1), (i, j - 1) and
+// (i + 1, j), so rows are stored bottom-up (row r holds i = n - 1 - r) and the
+// dependencies point up and left as wavefront_for() expects. Cells with i > j are
+// empty ranges and hold 0.
+static int DP_wavefront(const char* str, int nstr, int numThreads)
+{
+	if (nstr == 0)
+		return 0;
+
+	std::vector<int> L((size_t)nstr * nstr);
+	wavefront_for(nstr, nstr, 128, 128, numThreads, [&](int r, int j)
+	{
+		const int i = nstr - 1 - r;
+		int* row = &L[(size_t)r * nstr];
+		if (i > j)
+		{
+			row[j] = 0;
+			return;
+		}
+		if (i == j)
+		{
+			row[j] = 1;
+			return;
+		}
+
+		const int* below = row - nstr;	// i + 1
+		int count[3];
+		count[0] = (str[i] == str[j] ? 2 : 0) + below[j - 1];
+		count[1] = row[j - 1];
+		count[2] = below[j];
+		row[j] = std::max(count[0], std::max(count[1], count[2]));
+	});
+	return L[(size_t)(nstr - 1) * nstr + nstr - 1];
+}
+
+// DP(i, j) with one rolling row: going from i + 1 to i, row[j] still holds
+// DP(i + 1, j) when it is overwritten and the diagonal DP(i + 1, j - 1) is carried
+// in a register, so memory is O(n) and every pass is a forward scan.
+static int DP_rolling(const char* str, int nstr)
+{
+	if (nstr == 0)
+		return 0;
+
+	std::vector<int> row(nstr);
+	for (int i = nstr - 1; i >= 0; i--)
+	{
+		int diag = 0;	// DP(i + 1, i), an empty range
+		row[i] = 1;
+		const char c = str[i];
+		for (int j = i + 1; j < nstr; j++)
+		{
+			const int below = row[j];
+			row[j] = c == str[j] ? diag + 2 : std::max(below, row[j - 1]);
+			diag = below;
+		}
+	}
+	return row[nstr - 1];
+}
+
+// Manacher: the maximal palindrome around each of the 2n - 1 centers in O(n).
+// Center 2i is str[i], center 2i + 1 the gap after it; lengths[c] is the length of
+// the longest palindrome there (0 for a gap between different characters).
+static void manacher(const char* str, int nstr, std::vector<int>* lengths)
+{
+	lengths->assign(std::max(0, 2 * nstr - 1), 0);
+
+	// odd[i]: palindromes str[i - k + 1 .. i + k - 1] for k <= odd[i]
+	std::vector<int> odd(nstr);
+	for (int i = 0, l = 0, r = -1; i < nstr; i++)
+	{
+		int k = i > r ? 1 : std::min(odd[l + r - i], r - i + 1);
+		while (i - k >= 0 && i + k < nstr && str[i - k] == str[i + k])
+			k++;
+		odd[i] = k;
+		if (i + k - 1 > r)
+		{
+			l = i - k + 1;
+			r = i + k - 1;
+		}
+		(*lengths)[2 * i] = 2 * k - 1;
+	}
+
+	// even[i]: palindromes str[i - k .. i + k - 1] for k <= even[i], centered before str[i]
+	std::vector<int> even(nstr);
+	for (int i = 0, l = 0, r = -1; i < nstr; i++)
+	{
+		int k = i > r ? 0 : std::min(even[l + r - i + 1], r - i + 1);
+		while (i - k - 1 >= 0 && i + k < nstr && str[i - k - 1] == str[i + k])
+			k++;
+		even[i] = k;
+		if (i + k - 1 > r)
+		{
+			l = i - k;
+			r = i + k - 1;
+		}
+		if (i > 0)
+			(*lengths)[2 * i - 1] = 2 * k;
+	}
+}
+
+// longest palindromic substring, the first one if there are several
+static int longest_palindrome_substring(const char* str, int nstr, int* start)
+{
+	std::vector<int> lengths;
+	manacher(str, nstr, &lengths);
+
+	int best = 0;
+	*start = 0;
+	for (int c = 0; c < (int)lengths.size(); c++)
+	{
+		if (lengths[c] > best)
+		{
+			best = lengths[c];
+			*start = (c + 1) / 2 - best / 2;
+		}
+	}
+	return best;
+}
+
 static void solution(const char* str)
 {
 	int nstr = (int)strlen(str);
-	int max_count = DP(str, nstr, 0, nstr - 1);
-	printf("max_count: %d\n", max_count);
+	int max_count = DP_wavefront(str, nstr, 0);
+	printf("max_count: %d (rolling row: %d)\n", max_count, DP_rolling(str, nstr));
+
+	int start = 0;
+	int len = longest_palindrome_substring(str, nstr, &start);
+	printf("longest substring: %.*s\n", len, str + start);
+
+	std::vector<int> lengths;
+	manacher(str, nstr, &lengths);
+	printf("per center:");
+	for (size_t c = 0; c < lengths.size(); c++)
+		printf(" %d", lengths[c]);
+	printf("\n");
 }
 
 void test_longest_parlindromic_substring()
 {
 	solution("abcbaeabc");
-}
\ No newline at end of file
+	printf("\"ab\": recursive %d, wavefront %d\n", DP("ab", 2, 0, 1), DP_wavefront("ab", 2, 0));
+}
+
+static BenchBody bench_palindrome_dp(int n, std::mt19937& rng)
+{
+	std::string str = random_string(n, "ab", rng);
+	return [str]() { bench_consume(DP(str.c_str(), (int)str.size(), 0, (int)str.size() - 1)); };
+}
+
+static BenchBody bench_palindrome_wavefront(int n, std::mt19937& rng)
+{
+	std::string str = random_string(n, "ab", rng);
+	return [str]() { bench_consume(DP_wavefront(str.c_str(), (int)str.size(), 0)); };
+}
+
+static BenchBody bench_palindrome_rolling(int n, std::mt19937& rng)
+{
+	std::string str = random_string(n, "ab", rng);
+	return [str]() { bench_consume(DP_rolling(str.c_str(), (int)str.size())); };
+}
+
+static BenchBody bench_palindrome_manacher(int n, std::mt19937& rng)
+{
+	std::string str = random_string(n, "ab", rng);
+	return [str]()
+	{
+		int start = 0;
+		bench_consume(longest_palindrome_substring(str.c_str(), (int)str.size(), &start));
+	};
+}
+
+REGISTER_BENCHMARK(palindrome_dp, bench_palindrome_dp, 16, 22);
+REGISTER_BENCHMARK(palindrome_rolling, bench_palindrome_rolling, 8192, 200000);
+REGISTER_BENCHMARK(palindrome_manacher, bench_palindrome_manacher, 1000000, 100000000);
+REGISTER_BENCHMARK(palindrome_wavefront, bench_palindrome_wavefront, 4096, 8192);
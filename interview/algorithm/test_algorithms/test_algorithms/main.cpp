@@ -1,17 +1,89 @@
+#include <stdio.h>
+#include <string.h>
+
 #include "test_cases.h"
+#include "benchmark.h"
+
+struct TestCase
+{
+	const char* name;
+	void (*run)();
+};
+
+static const TestCase s_tests[] =
+{
+	{ "generate_subsets", test_generate_subsets },
+	{ "generate_parentheses", test_generate_parentheses },
+	{ "generate_permutations", test_generate_permutations },
+	{ "output_sink", test_output_sink },
+	{ "string_edit_distance", test_string_edit_distance },
+	{ "bk_tree", test_bk_tree },
+	{ "longest_parlindromic_substring", test_longest_parlindromic_substring },
+	{ "longest_increasing_sequence", test_longest_increasing_sequence },
+	{ "linear_partition", test_linear_partition },
+	{ "max_profit", test_max_profit },
+	{ "top_sort", test_top_sort },
+	{ "dag_executor", test_dag_executor },
+	{ "dynamic_top_sort", test_dynamic_top_sort },
+	{ "coin_change", test_coin_change },
+};
+static const int s_num_tests = sizeof(s_tests) / sizeof(s_tests[0]);
+
+static void print_usage()
+{
+	printf("usage: test_algorithms [test] [name...]     run the test_* samples (all by default)\n");
+	printf("       test_algorithms bench [options] [name...]\n");
+	printf("           --size=N --warmup=N --reps=N --seed=N\n");
+	printf("           --json=FILE --baseline=FILE --threshold=F (0.1 = 10%% slower fails)\n");
+	printf("       test_algorithms list\n");
+}
 
-int main()
+static int run_tests(int argc, char** argv)
 {
-	//test_generate_subsets();
-	//test_generate_parentheses();
-	//test_generate_permutations();
-	//test_string_edit_distance();
-	//test_longest_parlindromic_substring();
-	//test_longest_increasing_sequence();
-	//test_linear_partition();
-	//test_max_profit();
-	//test_top_sort();
-	test_coin_change();
-
-	return 0;
-}
\ No newline at end of file
+	int num_run = 0;
+	for (int i = 0; i < s_num_tests; i++)
+	{
+		bool selected = argc == 0;
+		for (int j = 0; j < argc && !selected; j++)
+			selected = strstr(s_tests[i].name, argv[j]) != nullptr;
+
+		if (selected)
+		{
+			printf("== %s\n", s_tests[i].name);
+			s_tests[i].run();
+			printf("\n");
+			num_run++;
+		}
+	}
+	return num_run > 0 ? 0 : 1;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc >= 2 && strcmp(argv[1], "bench") == 0)
+		return run_benchmarks(argc - 2, argv + 2);
+
+	if (argc >= 2 && strcmp(argv[1], "list") == 0)
+	{
+		printf("tests:\n");
+		for (int i = 0; i < s_num_tests; i++)
+			printf("  %s\n", s_tests[i].name);
+
+		printf("benchmarks:\n");
+		const std::vector<BenchInfo>& benchmarks = get_benchmarks();
+		for (size_t i = 0; i < benchmarks.size(); i++)
+			printf("  %-28s default size %d, max %d\n", benchmarks[i].name, benchmarks[i].default_size, benchmarks[i].max_size);
+		return 0;
+	}
+
+	if (argc >= 2 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0))
+	{
+		print_usage();
+		return 0;
+	}
+
+	if (argc >= 2 && strcmp(argv[1], "test") == 0)
+		return run_tests(argc - 2, argv + 2);
+
+	return run_tests(argc - 1, argv + 1);
+}
@@ -0,0 +1,312 @@
+#include <stdio.h>
+#include <errno.h>
+#include <limits.h>
+
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "benchmark.h"
+#include "output_sink.h"
+
+bool FileSink::Open(const char* filename)
+{
+	Close();
+#ifdef _WIN32
+	m_fd = _open(filename, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+	m_fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+	m_owned = true;
+	m_failed = m_fd < 0;
+	m_used = 0;
+	m_bytesWritten = 0;
+	return !m_failed;
+}
+
+void FileSink::Attach(int fd)
+{
+	Close();
+	m_fd = fd;
+	m_owned = false;
+	m_failed = false;
+	m_used = 0;
+	m_bytesWritten = 0;
+}
+
+bool FileSink::Flush()
+{
+	const char* p = m_buffer.data();
+	size_t left = m_used;
+	m_used = 0;
+	while (left > 0 && !m_failed)
+	{
+		if (m_fd < 0)
+		{
+			m_failed = true;
+			break;
+		}
+
+		// _write takes an unsigned count, so big buffers go out in pieces
+		const size_t chunk = left < (1u << 30) ? left : (1u << 30);
+#ifdef _WIN32
+		const int written = _write(m_fd, p, (unsigned int)chunk);
+#else
+		const ssize_t written = write(m_fd, p, chunk);
+		if (written < 0 && errno == EINTR)
+			continue;
+#endif
+		if (written <= 0)
+		{
+			m_failed = true;
+			break;
+		}
+		p += written;
+		left -= written;
+		m_bytesWritten += written;
+	}
+	return !m_failed;
+}
+
+void FileSink::Drain(size_t n)
+{
+	Flush();
+	if (n > m_buffer.size())
+		m_buffer.resize(n);
+}
+
+bool FileSink::Close()
+{
+	if (m_fd >= 0)
+	{
+		Flush();
+#ifdef _WIN32
+		if (m_owned && _close(m_fd) != 0)
+#else
+		if (m_owned && close(m_fd) != 0)
+#endif
+			m_failed = true;
+	}
+	m_fd = -1;
+	m_used = 0;
+	return !m_failed;
+}
+
+MappedSink::MappedSink(size_t growBytes) : m_growBytes(growBytes)
+{
+#ifdef _WIN32
+	m_file = INVALID_HANDLE_VALUE;
+#endif
+}
+
+bool MappedSink::Open(const char* filename)
+{
+	Close();
+	m_failed = false;
+	m_used = 0;
+#ifdef _WIN32
+	m_file = CreateFileA(filename, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	const bool opened = m_file != INVALID_HANDLE_VALUE;
+#else
+	m_fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	const bool opened = m_fd >= 0;
+#endif
+	if (!opened || !Map(0, m_growBytes))
+		Fail();
+	return !m_failed;
+}
+
+// extends the file from oldCapacity to capacity, with the new range allocated
+// on disk, and maps all of it
+bool MappedSink::Map(size_t oldCapacity, size_t capacity)
+{
+#ifdef _WIN32
+	const unsigned long long size = capacity;
+	m_mapping = CreateFileMappingA(m_file, NULL, PAGE_READWRITE, (DWORD)(size >> 32), (DWORD)size, NULL);
+	if (!m_mapping)
+		return false;
+
+	m_data = (char*)MapViewOfFile(m_mapping, FILE_MAP_WRITE, 0, 0, capacity);
+	if (!m_data)
+	{
+		CloseHandle(m_mapping);
+		m_mapping = nullptr;
+		return false;
+	}
+#else
+	// ftruncate alone leaves a sparse file, and a full disk then shows up as
+	// SIGBUS on a store into the mapping instead of as an error here
+#ifdef __APPLE__
+	if (ftruncate(m_fd, (off_t)capacity) != 0)
+		return false;
+#else
+	if (posix_fallocate(m_fd, (off_t)oldCapacity, (off_t)(capacity - oldCapacity)) != 0)
+		return false;
+#endif
+
+	void* p = mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+	if (p == MAP_FAILED)
+		return false;
+	m_data = (char*)p;
+#endif
+	m_capacity = capacity;
+	return true;
+}
+
+void MappedSink::Unmap()
+{
+	if (m_data && !m_failed)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(m_data);
+		CloseHandle(m_mapping);
+		m_mapping = nullptr;
+#else
+		munmap(m_data, m_capacity);
+#endif
+	}
+	m_data = nullptr;
+	m_capacity = 0;
+}
+
+// drops the mapping; from here on output goes round a scratch buffer
+void MappedSink::Fail()
+{
+	Unmap();
+	m_failed = true;
+	m_scratch.resize(1 << 16);
+	m_data = m_scratch.data();
+	m_capacity = m_scratch.size();
+	m_used = 0;
+}
+
+void MappedSink::Grow(size_t n)
+{
+	if (m_failed)
+	{
+		if (n > m_scratch.size())
+			m_scratch.resize(n);
+		m_data = m_scratch.data();
+		m_capacity = m_scratch.size();
+		m_used = 0;
+		return;
+	}
+
+	// the old mapping's pages stay in the file, so unmap and map the larger file
+	const size_t oldCapacity = m_capacity;
+	const size_t capacity = oldCapacity + (n > m_growBytes ? n : m_growBytes);
+	Unmap();
+	if (!Map(oldCapacity, capacity))
+		Fail();
+}
+
+bool MappedSink::Close()
+{
+#ifdef _WIN32
+	if (m_file == INVALID_HANDLE_VALUE)
+		return !m_failed;
+
+	Unmap();
+	LARGE_INTEGER size;
+	size.QuadPart = m_failed ? 0 : (LONGLONG)m_used;
+	if (!SetFilePointerEx(m_file, size, NULL, FILE_BEGIN) || !SetEndOfFile(m_file))
+		m_failed = true;
+	CloseHandle(m_file);
+	m_file = INVALID_HANDLE_VALUE;
+#else
+	if (m_fd < 0)
+		return !m_failed;
+
+	Unmap();
+	if (ftruncate(m_fd, m_failed ? 0 : (off_t)m_used) != 0)
+		m_failed = true;
+	if (close(m_fd) != 0)
+		m_failed = true;
+	m_fd = -1;
+#endif
+	return !m_failed;
+}
+
+void test_output_sink()
+{
+	int values[] = { 0, 9, 10, 99, 100, -42, 1234567, INT_MAX, INT_MIN };
+	const int numValues = sizeof(values) / sizeof(values[0]);
+
+	MemorySink memory;
+	TextWriter<MemorySink> text(memory);
+	text(values, numValues);
+	printf("text: %.*s", (int)memory.m_used, memory.m_data.data());
+
+	// a tiny growth step, so the mapping is extended and remapped many times
+	const std::string path = bench_temp_path("output_sink_test");
+	const char* filename = path.c_str();
+	MappedSink mapped(64);
+	BinaryWriter<MappedSink, uint16_t> binary(mapped, 3);
+	int record[3];
+	if (mapped.Open(filename))
+	{
+		for (int i = 0; i < 100; i++)
+		{
+			record[0] = i;
+			record[1] = i * i;
+			binary(record, i % 7 == 0 ? 2 : 3);
+		}
+	}
+	bool ok = mapped.Close();
+
+	std::vector<char> bytes;
+	std::ifstream in(filename, std::ios::binary);
+	if (ok && in)
+		bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+	in.close();
+	remove(filename);
+	printf("mapped: %d, %d bytes", ok, (int)bytes.size());
+	if (bytes.size() == 100 * 3 * sizeof(uint16_t))
+	{
+		uint16_t fields[3];
+		memcpy(fields, bytes.data() + 49 * sizeof(fields), sizeof(fields));
+		printf(", record 49: %d %d %d", fields[0], fields[1], fields[2]);
+	}
+	printf("\n");
+
+	// straight to stdout, after whatever printf still holds
+	fflush(stdout);
+	FileSink out(64);
+	out.Attach(1);
+	TextWriter<FileSink> parentheses(out, "()");
+	int pairs[] = { 0, 0, 1, 0, 1, 1 };
+	for (int i = 0; i < 3; i++)
+		parentheses(pairs, 6);
+	out.Close();
+}
+
+// n random ints formatted into memory, the cost of the text formatting alone
+static BenchBody bench_text_writer(int n, std::mt19937& rng)
+{
+	std::vector<int> values = random_ints(n, -1000000, 1000000, rng);
+	return [values]()
+	{
+		MemorySink memory;
+		TextWriter<MemorySink> text(memory);
+		for (size_t i = 0; i + 10 <= values.size(); i += 10)
+			text(values.data() + i, 10);
+		bench_consume((long long)memory.m_used);
+	};
+}
+
+REGISTER_BENCHMARK(text_writer, bench_text_writer, 1000000, 100000000);
@@ -0,0 +1,226 @@
+#pragma once
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+// Output sinks for enumerations whose output runs to gigabytes. A writer asks for
+// room with Reserve(n), formats straight into it and hands back what it used with
+// Commit(used); only a full buffer or mapping leaves the inline path. Writers are
+// backtrack.h visitors, so a generator takes them in place of a printf visitor.
+//
+//   Sink    char* Reserve(size_t n);  at least n writable bytes
+//           void Commit(size_t n);    n <= the last Reserve
+//           bool Failed() const;      set on the first I/O error; later output is dropped
+
+// Buffered writer on a file descriptor, one write per m_buffer worth of output.
+struct FileSink
+{
+	std::vector<char> m_buffer;
+	size_t m_used = 0;
+	int m_fd = -1;
+	bool m_owned = false;
+	bool m_failed = false;
+	unsigned long long m_bytesWritten = 0;
+
+	explicit FileSink(size_t bufferBytes = 1 << 20) : m_buffer(bufferBytes) {}
+	~FileSink() { Close(); }
+	FileSink(const FileSink&) = delete;
+	FileSink& operator=(const FileSink&) = delete;
+
+	// creates or truncates filename
+	bool Open(const char* filename);
+	// writes to an open descriptor (1 for stdout), left open by Close()
+	void Attach(int fd);
+	// flushes and closes; false if anything failed since Open
+	bool Close();
+	bool Flush();
+
+	char* Reserve(size_t n)
+	{
+		if (m_used + n > m_buffer.size())
+			Drain(n);
+		return m_buffer.data() + m_used;
+	}
+
+	void Commit(size_t n) { m_used += n; }
+	bool Failed() const { return m_failed; }
+
+private:
+	void Drain(size_t n);
+};
+
+// Writes into a shared mapping of the file, no copy through a user buffer or
+// write() call. The file is extended in m_growBytes steps (remapped each time)
+// and cut to the bytes written by Close(). Each step's disk space is reserved
+// before it is mapped (posix_fallocate; Windows allocates with the mapping), so
+// a full disk sets Failed() at the step rather than faulting on a later store.
+struct MappedSink
+{
+	char* m_data = nullptr;
+	size_t m_used = 0;				// bytes written so far, the final file size
+	size_t m_capacity = 0;
+	size_t m_growBytes;
+	bool m_failed = false;
+	std::vector<char> m_scratch;	// stands in for the mapping after a failure
+#ifdef _WIN32
+	void* m_file;					// HANDLEs
+	void* m_mapping = nullptr;
+#else
+	int m_fd = -1;
+#endif
+
+	explicit MappedSink(size_t growBytes = 64 << 20);
+	~MappedSink() { Close(); }
+	MappedSink(const MappedSink&) = delete;
+	MappedSink& operator=(const MappedSink&) = delete;
+
+	bool Open(const char* filename);
+	bool Close();
+
+	char* Reserve(size_t n)
+	{
+		if (m_used + n > m_capacity)
+			Grow(n);
+		return m_data + m_used;
+	}
+
+	void Commit(size_t n) { m_used += n; }
+	bool Failed() const { return m_failed; }
+
+private:
+	void Grow(size_t n);
+	bool Map(size_t oldCapacity, size_t capacity);
+	void Unmap();
+	void Fail();
+};
+
+// Output kept in memory, for tests and for timing the formatting alone.
+struct MemorySink
+{
+	std::vector<char> m_data;
+	size_t m_used = 0;
+
+	char* Reserve(size_t n)
+	{
+		if (m_used + n > m_data.size())
+			m_data.resize(std::max<size_t>(2 * m_data.size(), m_used + n));
+		return m_data.data() + m_used;
+	}
+
+	void Commit(size_t n) { m_used += n; }
+	bool Failed() const { return false; }
+};
+
+static const char kDigitPairs[201] =
+	"0001020304050607080910111213141516171819"
+	"2021222324252627282930313233343536373839"
+	"4041424344454647484950515253545556575859"
+	"6061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+// Decimal digits of v at out, two per step from kDigitPairs, written back to front
+// once the length is known; returns the count, at most 10. No locale, no format
+// string, no terminating zero.
+inline int format_uint(char* out, uint32_t v)
+{
+	int length = 1;
+	for (uint32_t bound = 10; length < 10 && v >= bound; bound *= 10)
+		length++;
+
+	char* p = out + length;
+	while (v >= 100)
+	{
+		const uint32_t pair = (v % 100) * 2;
+		v /= 100;
+		p -= 2;
+		p[0] = kDigitPairs[pair];
+		p[1] = kDigitPairs[pair + 1];
+	}
+	if (v >= 10)
+	{
+		p[-2] = kDigitPairs[v * 2];
+		p[-1] = kDigitPairs[v * 2 + 1];
+	}
+	else
+	{
+		p[-1] = (char)('0' + v);
+	}
+	return length;
+}
+
+// at most 11 characters
+inline int format_int(char* out, int v)
+{
+	if (v >= 0)
+		return format_uint(out, (uint32_t)v);
+	*out = '-';
+	return 1 + format_uint(out + 1, 0u - (uint32_t)v);
+}
+
+// One text line per solution: the values in decimal separated by spaces or, given
+// an alphabet, the character alphabet[value] for each with no separator, so
+// parentheses come out as "(()())" and subset flags as "0110".
+template <typename Sink>
+struct TextWriter
+{
+	Sink& m_sink;
+	const char* m_alphabet;
+
+	TextWriter(Sink& sink, const char* alphabet = nullptr) : m_sink(sink), m_alphabet(alphabet) {}
+
+	bool operator()(const int a[], int k)
+	{
+		char* start = m_sink.Reserve((size_t)k * 12 + 1);
+		char* p = start;
+		if (m_alphabet)
+		{
+			for (int i = 0; i < k; i++)
+				*p++ = m_alphabet[a[i]];
+		}
+		else
+		{
+			for (int i = 0; i < k; i++)
+			{
+				p += format_int(p, a[i]);
+				*p++ = ' ';
+			}
+			if (k > 0)
+				p--;
+		}
+		*p++ = '\n';
+		m_sink.Commit(p - start);
+		return !m_sink.Failed();
+	}
+};
+
+// Fixed-width binary records: m_width values of type Field per solution, shorter
+// solutions padded with Field(-1), so solution i starts at byte
+// i * m_width * sizeof(Field) and a reader can seek or map straight to it.
+// Native-endian, like the BK-tree image.
+template <typename Sink, typename Field = uint8_t>
+struct BinaryWriter
+{
+	Sink& m_sink;
+	int m_width;
+
+	BinaryWriter(Sink& sink, int width) : m_sink(sink), m_width(width) {}
+
+	bool operator()(const int a[], int k)
+	{
+		assert(k <= m_width);
+		const size_t bytes = (size_t)m_width * sizeof(Field);
+		char* out = m_sink.Reserve(bytes);
+		for (int i = 0; i < m_width; i++)
+		{
+			const Field field = i < k ? (Field)a[i] : (Field)-1;
+			memcpy(out + i * sizeof(Field), &field, sizeof(Field));	// the sink may be unaligned
+		}
+		m_sink.Commit(bytes);
+		return !m_sink.Failed();
+	}
+};
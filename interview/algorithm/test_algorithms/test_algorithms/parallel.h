@@ -0,0 +1,38 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+inline int default_num_threads()
+{
+	unsigned int n = std::thread::hardware_concurrency();
+	return n > 0 ? (int)n : 1;
+}
+
+// Runs fn(task, worker) for every task in [0, numTasks) on numThreads threads
+// (0 = one per core). Tasks are handed out through an atomic counter, so uneven
+// tasks balance themselves; worker is in [0, numThreads) and lets callers keep
+// per-thread scratch without locking.
+template <typename Fn>
+void parallel_for(int numTasks, int numThreads, Fn fn)
+{
+	if (numThreads <= 0)
+		numThreads = default_num_threads();
+	numThreads = std::max(1, std::min(numThreads, numTasks));
+
+	std::atomic<int> next(0);
+	auto worker = [&](int workerIndex)
+	{
+		for (int task = next++; task < numTasks; task = next++)
+			fn(task, workerIndex);
+	};
+
+	std::vector<std::thread> threads;
+	for (int i = 1; i < numThreads; i++)
+		threads.emplace_back(worker, i);
+	worker(0);
+	for (size_t i = 0; i < threads.size(); i++)
+		threads[i].join();
+}
@@ -1,5 +1,17 @@
 #include <stdio.h>
 #include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "alignment.h"
+#include "benchmark.h"
+#include "parallel.h"
+#include "string_edit_distance.h"
+#include "wavefront.h"
 
 #define MATCH 0
 #define INSERT 1
@@ -42,16 +54,599 @@ int string_compare(const char* s, const char* t, int i, int j)
 	return M[i][j];
 }
 
-void string_compare(const char* s, const char* t)
+static int edit_distance(const char* s, const char* t)
 {
 	int s_i = (int)strlen(s) - 1;
 	int t_j = (int)strlen(t) - 1;
 	memset(M, -1, sizeof(M));
-	int cost = string_compare(s, t, s_i, t_j);
+	return string_compare(s, t, s_i, t_j);
+}
+
+void string_compare(const char* s, const char* t)
+{
+	int cost = edit_distance(s, t);
 	printf("cost: %d\n", cost);
 }
 
+static const int kWavefrontTile = 256;
+
+int edit_distance_wavefront(const char* s, int ns, const char* t, int nt, int numThreads)
+{
+	const int cols = nt + 1;
+	std::vector<int> D((size_t)(ns + 1) * cols);
+	wavefront_for(ns + 1, nt + 1, kWavefrontTile, kWavefrontTile, numThreads, [&](int i, int j)
+	{
+		int* row = &D[(size_t)i * cols];
+		if (i == 0)
+			row[j] = j * cost_indel(' ');
+		else if (j == 0)
+			row[j] = i * cost_indel(' ');
+		else
+		{
+			const int* up = row - cols;
+			int opt[3];
+			opt[MATCH] = up[j - 1] + cost_match(s[i - 1], t[j - 1]);
+			opt[INSERT] = row[j - 1] + cost_indel(t[j - 1]);
+			opt[DELETE] = up[j] + cost_indel(s[i - 1]);
+			row[j] = std::min(opt[MATCH], std::min(opt[INSERT], opt[DELETE]));
+		}
+	});
+	return D.back();
+}
+
+template <typename Token>
+struct Hirschberg
+{
+	std::vector<int> m_forward;
+	std::vector<int> m_backward;
+	std::string* m_script;
+	int m_maxDepth;
+
+	// row[j] = distance(s[0, ns), t[0, j)), one row kept and updated in place
+	static void LastRow(const Token* s, int ns, const Token* t, int nt, int* row)
+	{
+		for (int j = 0; j <= nt; j++)
+			row[j] = j;
+		for (int i = 0; i < ns; i++)
+		{
+			int diag = row[0];
+			row[0] = i + 1;
+			for (int j = 1; j <= nt; j++)
+			{
+				const int up = row[j];
+				row[j] = std::min(diag + (s[i] == t[j - 1] ? 0 : 1), std::min(up, row[j - 1]) + 1);
+				diag = up;
+			}
+		}
+	}
+
+	// row[j] = distance(s[0, ns), t[j, nt)), the same walk from the far end
+	static void LastRowReversed(const Token* s, int ns, const Token* t, int nt, int* row)
+	{
+		for (int j = 0; j <= nt; j++)
+			row[nt - j] = j;
+		for (int i = ns - 1; i >= 0; i--)
+		{
+			int diag = row[nt];
+			row[nt] = ns - i;
+			for (int j = nt - 1; j >= 0; j--)
+			{
+				const int down = row[j];
+				row[j] = std::min(diag + (s[i] == t[j] ? 0 : 1), std::min(down, row[j + 1]) + 1);
+				diag = down;
+			}
+		}
+	}
+
+	void Solve(const Token* s, int ns, const Token* t, int nt, int depth)
+	{
+		m_maxDepth = std::max(m_maxDepth, depth);
+		if (ns == 0)
+		{
+			m_script->append(nt, 'I');
+			return;
+		}
+		if (nt == 0)
+		{
+			m_script->append(ns, 'D');
+			return;
+		}
+		if (ns == 1)
+		{
+			// keep s[0] against its first match in t, else substitute it for t[0]
+			int j = 0;
+			while (j < nt && !(t[j] == s[0]))
+				j++;
+			const char op = j < nt ? 'M' : 'S';
+			j = j < nt ? j : 0;
+			m_script->append(j, 'I');
+			m_script->push_back(op);
+			m_script->append(nt - j - 1, 'I');
+			return;
+		}
+
+		// the optimal path crosses row mid at the column where the cost from the
+		// top plus the cost to the bottom is smallest
+		const int mid = ns / 2;
+		LastRow(s, mid, t, nt, m_forward.data());
+		LastRowReversed(s + mid, ns - mid, t, nt, m_backward.data());
+		int split = 0;
+		for (int j = 1; j <= nt; j++)
+		{
+			if (m_forward[j] + m_backward[j] < m_forward[split] + m_backward[split])
+				split = j;
+		}
+
+		Solve(s, mid, t, split, depth + 1);
+		Solve(s + mid, ns - mid, t + split, nt - split, depth + 1);
+	}
+};
+
+template <typename Token>
+static int edit_script_impl(const Token* s, int ns, const Token* t, int nt, std::string* script, EditScriptStats* stats)
+{
+	// the score rows run over the shorter input; ops are flipped back at the end
+	const bool swapped = nt > ns;
+	if (swapped)
+	{
+		std::swap(s, t);
+		std::swap(ns, nt);
+	}
+
+	script->clear();
+	script->reserve(ns + nt);
+
+	// common prefix and suffix align for free and are often most of a document diff
+	int prefix = 0;
+	while (prefix < nt && s[prefix] == t[prefix])
+		prefix++;
+	int suffix = 0;
+	while (suffix < nt - prefix && s[ns - 1 - suffix] == t[nt - 1 - suffix])
+		suffix++;
+
+	Hirschberg<Token> h;
+	h.m_forward.resize(nt - prefix - suffix + 1);
+	h.m_backward.resize(nt - prefix - suffix + 1);
+	h.m_script = script;
+	h.m_maxDepth = 0;
+
+	script->append(prefix, 'M');
+	h.Solve(s + prefix, ns - prefix - suffix, t + prefix, nt - prefix - suffix, 0);
+	script->append(suffix, 'M');
+
+	int cost = 0;
+	for (size_t i = 0; i < script->size(); i++)
+	{
+		char& op = (*script)[i];
+		cost += op != 'M';
+		if (swapped && op == 'I')
+			op = 'D';
+		else if (swapped && op == 'D')
+			op = 'I';
+	}
+
+	if (stats)
+	{
+		stats->cost = cost;
+		stats->workspaceBytes = (h.m_forward.capacity() + h.m_backward.capacity()) * sizeof(int);
+		stats->maxDepth = h.m_maxDepth;
+	}
+	return cost;
+}
+
+int edit_script(const char* s, int ns, const char* t, int nt, std::string* script, EditScriptStats* stats)
+{
+	return edit_script_impl(s, ns, t, nt, script, stats);
+}
+
+int edit_script(const int* s, int ns, const int* t, int nt, std::string* script, EditScriptStats* stats)
+{
+	return edit_script_impl(s, ns, t, nt, script, stats);
+}
+
+// Any alignment crosses column col at some row i, so it costs at least
+// D[i][col] + |(m - i) - (n - col)|; the column is rebuilt from the delta bits.
+int BitParallelEditDistance::ColumnLowerBound(int m, int n, int col) const
+{
+	int v = col;
+	int bound = v + abs(m - (n - col));
+	for (int i = 1; i <= m; i++)
+	{
+		const int b = (i - 1) / 64;
+		const int bit = (i - 1) % 64;
+		v += (int)((m_pv[b] >> bit) & 1) - (int)((m_mv[b] >> bit) & 1);
+		bound = std::min(bound, v + abs((m - i) - (n - col)));
+	}
+	return bound;
+}
+
+int BitParallelEditDistance::Compute(const char* s, int ns, const char* t, int nt, int maxDist)
+{
+	if (ns > nt)
+	{
+		std::swap(s, t);
+		std::swap(ns, nt);
+	}
+
+	const int m = ns;
+	const int n = nt;
+	if (maxDist >= 0 && n - m > maxDist)
+		return -1;
+	if (m == 0)
+		return n;
+
+	const int numBlocks = (m + 63) / 64;
+	if ((int)m_peq.size() < 256 * numBlocks)
+		m_peq.assign(256 * numBlocks, 0);	// all zero between calls, see cleanup below
+
+	for (int i = 0; i < m; i++)
+		m_peq[(unsigned char)s[i] * numBlocks + i / 64] |= (uint64_t)1 << (i % 64);
+
+	m_pv.assign(numBlocks, ~(uint64_t)0);
+	m_mv.assign(numBlocks, 0);
+
+	const uint64_t topBit = (uint64_t)1 << 63;
+	const uint64_t lastBit = (uint64_t)1 << ((m - 1) % 64);
+
+	int score = m;	// D[m][j]
+	bool exceeded = false;
+	for (int j = 0; j < n; j++)
+	{
+		const uint64_t* eqs = &m_peq[(unsigned char)t[j] * numBlocks];
+
+		// hin is the horizontal delta entering the block from above; the top
+		// row is D[0][j] = j, so block 0 always gets +1
+		int hin = 1;
+		for (int b = 0; b < numBlocks; b++)
+		{
+			uint64_t pv = m_pv[b];
+			uint64_t mv = m_mv[b];
+			uint64_t eq = eqs[b];
+			const uint64_t high = b == numBlocks - 1 ? lastBit : topBit;
+
+			const uint64_t xv = eq | mv;
+			if (hin < 0)
+				eq |= 1;
+			const uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+			uint64_t ph = mv | ~(xh | pv);
+			uint64_t mh = pv & xh;
+
+			const int hout = (ph & high) ? 1 : ((mh & high) ? -1 : 0);
+			ph <<= 1;
+			mh <<= 1;
+			if (hin < 0)
+				mh |= 1;
+			else if (hin > 0)
+				ph |= 1;
+
+			m_pv[b] = mh | ~(xv | ph);
+			m_mv[b] = ph & xv;
+			hin = hout;
+		}
+		score += hin;
+
+		if (maxDist >= 0)
+		{
+			// the last row changes by at most one per column; the full column
+			// bound costs O(m), so it only runs every 64 columns
+			const int remaining = n - 1 - j;
+			if (score - remaining > maxDist || ((j & 63) == 63 && ColumnLowerBound(m, n, j + 1) > maxDist))
+			{
+				exceeded = true;
+				break;
+			}
+		}
+	}
+
+	for (int i = 0; i < m; i++)
+		m_peq[(unsigned char)s[i] * numBlocks + i / 64] = 0;
+
+	if (exceeded || (maxDist >= 0 && score > maxDist))
+		return -1;
+	return score;
+}
+
+// Many-to-many distances. The pair space is cut into kMatrixTile x kMatrixTile
+// tiles so a tile's strings stay in cache while every pair in it is compared;
+// tiles run on a thread pool and each worker owns its BitParallelEditDistance.
+static const int kMatrixTile = 64;
+
+// out is rows.size() x cols.size(), row-major
+void edit_distance_matrix(const std::vector<std::string>& rows, const std::vector<std::string>& cols,
+	int* out, int numThreads)
+{
+	const int nrows = (int)rows.size();
+	const int ncols = (int)cols.size();
+	const int rowTiles = (nrows + kMatrixTile - 1) / kMatrixTile;
+	const int colTiles = (ncols + kMatrixTile - 1) / kMatrixTile;
+	if (numThreads <= 0)
+		numThreads = default_num_threads();
+
+	std::vector<BitParallelEditDistance> scratch(numThreads);
+	parallel_for(rowTiles * colTiles, numThreads, [&](int tile, int worker)
+	{
+		BitParallelEditDistance& bp = scratch[worker];
+		const int r0 = (tile / colTiles) * kMatrixTile;
+		const int c0 = (tile % colTiles) * kMatrixTile;
+		const int r1 = std::min(r0 + kMatrixTile, nrows);
+		const int c1 = std::min(c0 + kMatrixTile, ncols);
+		for (int r = r0; r < r1; r++)
+		{
+			const std::string& s = rows[r];
+			for (int c = c0; c < c1; c++)
+				out[(size_t)r * ncols + c] = bp.Compute(s.c_str(), (int)s.size(), cols[c].c_str(), (int)cols[c].size());
+		}
+	});
+}
+
+static bool operator<(const EditDistanceMatch& a, const EditDistanceMatch& b)
+{
+	return a.dist != b.dist ? a.dist < b.dist : a.col < b.col;
+}
+
+// k closest cols for every row, ascending by distance (ties by column). Each task
+// owns a block of rows and walks the columns tile by tile in increasing order; once
+// a row has k matches, a later column has to beat the current k-th distance
+// strictly, which becomes the threshold, so most pairs stop early.
+void edit_distance_top_k(const std::vector<std::string>& rows, const std::vector<std::string>& cols, int k,
+	std::vector<std::vector<EditDistanceMatch>>* out, int numThreads)
+{
+	const int nrows = (int)rows.size();
+	const int ncols = (int)cols.size();
+	const int rowTiles = (nrows + kMatrixTile - 1) / kMatrixTile;
+	if (numThreads <= 0)
+		numThreads = default_num_threads();
+
+	out->assign(nrows, std::vector<EditDistanceMatch>());
+	if (k <= 0)
+		return;
+
+	std::vector<BitParallelEditDistance> scratch(numThreads);
+	parallel_for(rowTiles, numThreads, [&](int tile, int worker)
+	{
+		BitParallelEditDistance& bp = scratch[worker];
+		const int r0 = tile * kMatrixTile;
+		const int r1 = std::min(r0 + kMatrixTile, nrows);
+		for (int c0 = 0; c0 < ncols; c0 += kMatrixTile)
+		{
+			const int c1 = std::min(c0 + kMatrixTile, ncols);
+			for (int r = r0; r < r1; r++)
+			{
+				// max-heap of the best k so far
+				std::vector<EditDistanceMatch>& best = (*out)[r];
+				const std::string& s = rows[r];
+				for (int c = c0; c < c1; c++)
+				{
+					const bool full = (int)best.size() == k;
+					if (full && best.front().dist == 0)
+						break;
+
+					const int limit = full ? best.front().dist - 1 : -1;
+					const int d = bp.Compute(s.c_str(), (int)s.size(), cols[c].c_str(), (int)cols[c].size(), limit);
+					if (d < 0)
+						continue;
+
+					EditDistanceMatch m = { c, d };
+					if (!full)
+					{
+						best.push_back(m);
+						std::push_heap(best.begin(), best.end());
+					}
+					else
+					{
+						std::pop_heap(best.begin(), best.end());
+						best.back() = m;
+						std::push_heap(best.begin(), best.end());
+					}
+				}
+			}
+		}
+
+		for (int r = r0; r < r1; r++)
+			std::sort_heap((*out)[r].begin(), (*out)[r].end());
+	});
+}
+
 void test_string_edit_distance()
 {
 	string_compare("ah", "ab");
-}
\ No newline at end of file
+
+	BitParallelEditDistance bp;
+	printf("bit-parallel cost: %d\n", bp.Compute("ah", 2, "ab", 2));
+
+	// longer than one 64-bit block and well past the M[64][64] table
+	std::string a(150, 'a');
+	std::string b = a;
+	b[10] = 'b';
+	b.erase(100, 3);
+	b += "xyz";
+	printf("bit-parallel cost (150 chars): %d\n", bp.Compute(a.c_str(), (int)a.size(), b.c_str(), (int)b.size()));
+	printf("wavefront cost (150 chars): %d\n", edit_distance_wavefront(a.c_str(), (int)a.size(), b.c_str(), (int)b.size()));
+	printf("bit-parallel cost <= 3: %d, <= 10: %d\n",
+		bp.Compute(a.c_str(), (int)a.size(), b.c_str(), (int)b.size(), 3),
+		bp.Compute(a.c_str(), (int)a.size(), b.c_str(), (int)b.size(), 10));
+
+	std::string script;
+	EditScriptStats stats;
+	edit_script("kitten", 6, "sitting", 7, &script, &stats);
+	printf("kitten -> sitting: %s (cost %d, %d bytes of rows)\n", script.c_str(), stats.cost, (int)stats.workspaceBytes);
+
+	Aligner<UnitCost> unit;
+	Aligner<LinearCost<3, 2>> linear;
+	Aligner<AffineCost<2, 3, 1>> affine;
+	printf("kitten -> sitting: unit %d, linear(3, 2) %d, affine(2, 3 + 1/char) %d\n",
+		unit.Compute("kitten", 6, "sitting", 7), linear.Compute("kitten", 6, "sitting", 7),
+		affine.Compute("kitten", 6, "sitting", 7));
+
+	// one long gap is cheaper than scattered ones under affine costs
+	printf("affine: abcdefgh -> abgh %d, aXcXeXgh -> abgh %d\n",
+		affine.Compute("abcdefgh", 8, "abgh", 4), affine.Compute("aXcXeXgh", 8, "abgh", 4));
+
+	// vowel swaps are cheap, as in a phonetic match
+	MatrixCost vowels(4, 3, 1);
+	const char* v = "aeiou";
+	for (int i = 0; i < 5; i++)
+		for (int j = i + 1; j < 5; j++)
+			vowels.SetSubstitute(v[i], v[j], 1);
+	Aligner<MatrixCost> phonetic(vowels);
+	printf("matrix: smith -> smyth %d, smith -> smoth %d\n", phonetic.Compute("smith", 5, "smyth", 5), phonetic.Compute("smith", 5, "smoth", 5));
+
+	std::vector<std::string> names = { "jon smith", "john smith", "jane smyth", "jon smit", "joan smith" };
+	std::vector<int> matrix(names.size() * names.size());
+	edit_distance_matrix(names, names, matrix.data());
+	for (size_t r = 0; r < names.size(); r++)
+	{
+		printf("%-12s", names[r].c_str());
+		for (size_t c = 0; c < names.size(); c++)
+			printf(" %2d", matrix[r * names.size() + c]);
+		printf("\n");
+	}
+
+	std::vector<std::vector<EditDistanceMatch>> nearest;
+	edit_distance_top_k(names, names, 3, &nearest);
+	for (size_t r = 0; r < names.size(); r++)
+	{
+		printf("%-12s top 3:", names[r].c_str());
+		for (size_t i = 0; i < nearest[r].size(); i++)
+			printf(" %s (%d)", names[nearest[r][i].col].c_str(), nearest[r][i].dist);
+		printf("\n");
+	}
+}
+
+static BenchBody bench_edit_distance(int n, std::mt19937& rng)
+{
+	std::string s = random_string(n, "acgt", rng);
+	std::string t = random_string(n, "acgt", rng);
+	return [s, t]() { bench_consume(edit_distance(s.c_str(), t.c_str())); };
+}
+
+REGISTER_BENCHMARK(edit_distance, bench_edit_distance, 64, 64);
+
+static BenchBody bench_edit_distance_bitparallel(int n, std::mt19937& rng)
+{
+	std::string s = random_string(n, "acgt", rng);
+	std::string t = random_string(n, "acgt", rng);
+	BitParallelEditDistance bp;
+	return [s, t, bp]() mutable { bench_consume(bp.Compute(s.c_str(), (int)s.size(), t.c_str(), (int)t.size())); };
+}
+
+// mostly-similar strings against a tight threshold, the typo-lookup case: t is s
+// with a few scattered edits, so the distance stays within k = 8 and the band runs
+// the whole length instead of cutting off early
+static BenchBody bench_edit_distance_threshold(int n, std::mt19937& rng)
+{
+	std::string s = random_string(n, "acgt", rng);
+	std::string t = s;
+	std::uniform_int_distribution<int> edit(0, 2);
+	for (int e = 0; e < 4 && !t.empty(); e++)
+	{
+		const size_t at = rng() % t.size();
+		const int kind = edit(rng);
+		if (kind == 0)
+			t[at] = t[at] == 'a' ? 'c' : 'a';
+		else if (kind == 1)
+			t.erase(at, 1);
+		else
+			t.insert(at, 1, 'g');
+	}
+	BitParallelEditDistance bp;
+	return [s, t, bp]() mutable { bench_consume(bp.Compute(s.c_str(), (int)s.size(), t.c_str(), (int)t.size(), 8)); };
+}
+
+static BenchBody bench_edit_distance_wavefront(int n, std::mt19937& rng)
+{
+	std::string s = random_string(n, "acgt", rng);
+	std::string t = random_string(n, "acgt", rng);
+	return [s, t]() { bench_consume(edit_distance_wavefront(s.c_str(), (int)s.size(), t.c_str(), (int)t.size())); };
+}
+
+// token streams, the second a lightly edited copy of the first, as in a document diff
+static BenchBody bench_edit_script(int n, std::mt19937& rng)
+{
+	std::vector<int> a = random_ints(n, 0, 50000, rng);
+	std::vector<int> b;
+	std::uniform_int_distribution<int> edit(0, 99);
+	for (int i = 0; i < n; i++)
+	{
+		int e = edit(rng);
+		if (e == 0)
+			continue;
+		b.push_back(e == 1 ? a[i] + 1 : a[i]);
+		if (e == 2)
+			b.push_back(-1);
+	}
+
+	return [a, b]()
+	{
+		std::string script;
+		EditScriptStats stats;
+		bench_consume(edit_script(a.data(), (int)a.size(), b.data(), (int)b.size(), &script, &stats));
+		bench_report_bytes(stats.workspaceBytes + script.capacity());
+	};
+}
+
+template <typename Cost>
+static BenchBody bench_align(int n, std::mt19937& rng)
+{
+	std::string s = random_string(n, "acgt", rng);
+	std::string t = random_string(n, "acgt", rng);
+	Aligner<Cost> aligner;
+	return [s, t, aligner]() mutable { bench_consume(aligner.Compute(s.c_str(), (int)s.size(), t.c_str(), (int)t.size())); };
+}
+
+static BenchBody bench_align_matrix(int n, std::mt19937& rng)
+{
+	std::string s = random_string(n, "acgt", rng);
+	std::string t = random_string(n, "acgt", rng);
+	MatrixCost cost(3, 4, 1);
+	cost.SetSubstitute('a', 'g', 1);	// transitions are cheaper than transversions
+	cost.SetSubstitute('c', 't', 1);
+	Aligner<MatrixCost> aligner(cost);
+	return [s, t, aligner]() mutable { bench_consume(aligner.Compute(s.c_str(), (int)s.size(), t.c_str(), (int)t.size())); };
+}
+
+typedef LinearCost<3, 2> BenchLinearCost;
+typedef AffineCost<2, 3, 1> BenchAffineCost;
+
+REGISTER_BENCHMARK(align_unit, bench_align<UnitCost>, 4096, 100000);
+REGISTER_BENCHMARK(align_linear, bench_align<BenchLinearCost>, 4096, 20000);
+REGISTER_BENCHMARK(align_affine, bench_align<BenchAffineCost>, 4096, 20000);
+REGISTER_BENCHMARK(align_matrix, bench_align_matrix, 4096, 20000);
+REGISTER_BENCHMARK(edit_script, bench_edit_script, 10000, 1000000);
+REGISTER_BENCHMARK(edit_distance_wavefront, bench_edit_distance_wavefront, 4096, 20000);
+REGISTER_BENCHMARK(edit_distance_bitparallel, bench_edit_distance_bitparallel, 4096, 100000);
+REGISTER_BENCHMARK(edit_distance_threshold, bench_edit_distance_threshold, 4096, 10000000);
+
+static std::vector<std::string> random_names(int n, std::mt19937& rng)
+{
+	std::uniform_int_distribution<int> len(5, 20);
+	std::vector<std::string> names(n);
+	for (int i = 0; i < n; i++)
+		names[i] = random_string(len(rng), "abcdefghijklmnopqrstuvwxyz ", rng);
+	return names;
+}
+
+static BenchBody bench_edit_distance_matrix(int n, std::mt19937& rng)
+{
+	std::vector<std::string> names = random_names(n, rng);
+	return [names]()
+	{
+		std::vector<int> matrix(names.size() * names.size());
+		edit_distance_matrix(names, names, matrix.data());
+		bench_consume(matrix.back());
+	};
+}
+
+static BenchBody bench_edit_distance_top_k(int n, std::mt19937& rng)
+{
+	std::vector<std::string> names = random_names(n, rng);
+	return [names]()
+	{
+		std::vector<std::vector<EditDistanceMatch>> nearest;
+		edit_distance_top_k(names, names, 5, &nearest);
+		bench_consume(nearest.back().back().dist);
+	};
+}
+
+REGISTER_BENCHMARK(edit_distance_matrix, bench_edit_distance_matrix, 1000, 30000);
+REGISTER_BENCHMARK(edit_distance_top_k, bench_edit_distance_top_k, 1000, 100000);
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Myers / Hyyro bit-parallel Levenshtein distance, with the unit costs of
+// cost_match and cost_indel in string_edit_distance.cpp. The shorter string is
+// the pattern, packed 64 characters per word; every text character updates the
+// vertical delta bits of all words, so the cost is O(ceil(m / 64) * n) word
+// operations for any length. Buffers are kept between calls: reuse one
+// instance per thread.
+struct BitParallelEditDistance
+{
+	std::vector<uint64_t> m_peq;	// pattern match masks, m_peq[c * numBlocks + block]
+	std::vector<uint64_t> m_pv;		// +1 vertical deltas
+	std::vector<uint64_t> m_mv;		// -1 vertical deltas
+
+	// With maxDist >= 0, returns -1 as soon as the distance is known to exceed maxDist.
+	int Compute(const char* s, int ns, const char* t, int nt, int maxDist = -1);
+
+private:
+	int ColumnLowerBound(int m, int n, int col) const;
+};
+
+// The string_compare() recurrence on a full (ns + 1) x (nt + 1) table filled with
+// wavefront_for(), so one large pair uses every core; O(ns * nt) memory.
+int edit_distance_wavefront(const char* s, int ns, const char* t, int nt, int numThreads = 0);
+
+struct EditScriptStats
+{
+	int cost = 0;				// number of non-'M' operations
+	size_t workspaceBytes = 0;	// score rows, O(min(ns, nt))
+	int maxDepth = 0;			// deepest Hirschberg recursion
+};
+
+// Unit-cost alignment of s against t as an edit script: 'M' match, 'S' substitute,
+// 'D' delete s[i], 'I' insert t[j]. Hirschberg's divide and conquer keeps two score
+// rows of the shorter input instead of the full table, at about twice the time of
+// the distance alone. Returns the cost.
+int edit_script(const char* s, int ns, const char* t, int nt, std::string* script, EditScriptStats* stats = nullptr);
+int edit_script(const int* s, int ns, const int* t, int nt, std::string* script, EditScriptStats* stats = nullptr);
+
+struct EditDistanceMatch
+{
+	int col;
+	int dist;
+};
+
+// out is rows.size() x cols.size(), row-major; numThreads 0 = one per core
+void edit_distance_matrix(const std::vector<std::string>& rows, const std::vector<std::string>& cols,
+	int* out, int numThreads = 0);
+
+// k closest cols for every row, ascending by distance (ties by column)
+void edit_distance_top_k(const std::vector<std::string>& rows, const std::vector<std::string>& cols, int k,
+	std::vector<std::vector<EditDistanceMatch>>* out, int numThreads = 0);
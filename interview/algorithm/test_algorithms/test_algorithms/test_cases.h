@@ -9,4 +9,8 @@ void test_longest_increasing_sequence();
 void test_linear_partition();
 void test_max_profit();
 void test_top_sort();
-void test_coin_change();
\ No newline at end of file
+void test_coin_change();
+void test_bk_tree();
+void test_dag_executor();
+void test_dynamic_top_sort();
+void test_output_sink();
\ No newline at end of file
@@ -2,6 +2,11 @@
 #include <string.h>
 #include <assert.h>
 
+#include <algorithm>
+
+#include "benchmark.h"
+#include "toplogical_sort.h"
+
 struct EdgeMatrix
 {
 	int m_numRows = 0;
@@ -128,6 +133,273 @@ static bool top_sort(const int num_vertices, EdgeMatrix* pEdges, int* L, int* ou
 	return foundEdge;
 }
 
+void CsrGraph::Build(int numVertices, const std::vector<std::pair<int, int>>& edges)
+{
+	m_numVertices = numVertices;
+	m_offsets.assign(numVertices + 1, 0);
+	m_inDegree.assign(numVertices, 0);
+	m_targets.resize(edges.size());
+
+	for (size_t e = 0; e < edges.size(); e++)
+	{
+		assert(edges[e].first >= 0 && edges[e].first < numVertices);
+		assert(edges[e].second >= 0 && edges[e].second < numVertices);
+		m_offsets[edges[e].first + 1]++;
+		m_inDegree[edges[e].second]++;
+	}
+	for (int v = 0; v < numVertices; v++)
+		m_offsets[v + 1] += m_offsets[v];
+
+	// fill each source's slice front to back, keeping the input order of its edges
+	std::vector<int> next(m_offsets.begin(), m_offsets.end() - 1);
+	for (size_t e = 0; e < edges.size(); e++)
+		m_targets[next[edges[e].first]++] = edges[e].second;
+}
+
+bool csr_top_sort(const CsrGraph& graph, std::vector<int>* order)
+{
+	const int n = graph.m_numVertices;
+	std::vector<int> inDegree(graph.m_inDegree);
+
+	// order doubles as the FIFO of vertices whose in-degree reached 0
+	order->clear();
+	order->reserve(n);
+	for (int v = 0; v < n; v++)
+	{
+		if (inDegree[v] == 0)
+			order->push_back(v);
+	}
+
+	for (size_t head = 0; head < order->size(); head++)
+	{
+		const int v = (*order)[head];
+		for (const int* w = graph.OutBegin(v); w != graph.OutEnd(v); w++)
+		{
+			if (--inDegree[*w] == 0)
+				order->push_back(*w);
+		}
+	}
+
+	return (int)order->size() < n;
+}
+
+bool critical_path(const CsrGraph& graph, const std::vector<long long>& cost, CriticalPath* out)
+{
+	const int n = graph.m_numVertices;
+	assert((int)cost.size() == n);
+
+	std::vector<int> order;
+	if (csr_top_sort(graph, &order))
+		return false;
+
+	std::vector<long long>& es = out->earliestStart;
+	std::vector<int> level(n, 0);
+	es.assign(n, 0);
+	out->length = 0;
+	out->totalCost = 0;
+	for (int k = 0; k < n; k++)
+	{
+		const int v = order[k];
+		const long long finish = es[v] + cost[v];
+		out->length = std::max(out->length, finish);
+		out->totalCost += cost[v];
+		for (const int* w = graph.OutBegin(v); w != graph.OutEnd(v); w++)
+		{
+			es[*w] = std::max(es[*w], finish);
+			level[*w] = std::max(level[*w], level[v] + 1);
+		}
+	}
+
+	// latest finish of v = min over successors of their latest start, or the end
+	std::vector<long long>& ls = out->latestStart;
+	ls.resize(n);
+	for (int k = n - 1; k >= 0; k--)
+	{
+		const int v = order[k];
+		long long latestFinish = out->length;
+		for (const int* w = graph.OutBegin(v); w != graph.OutEnd(v); w++)
+			latestFinish = std::min(latestFinish, ls[*w]);
+		ls[v] = latestFinish - cost[v];
+	}
+
+	out->slack.resize(n);
+	for (int v = 0; v < n; v++)
+		out->slack[v] = ls[v] - es[v];
+
+	// follow zero-slack vertices that start exactly when their predecessor ends
+	out->chain.clear();
+	int v = -1;
+	for (int k = 0; k < n && v < 0; k++)
+	{
+		if (es[order[k]] == 0 && out->slack[order[k]] == 0)
+			v = order[k];
+	}
+	while (v >= 0)
+	{
+		out->chain.push_back(v);
+		int next = -1;
+		for (const int* w = graph.OutBegin(v); w != graph.OutEnd(v) && next < 0; w++)
+		{
+			if (out->slack[*w] == 0 && es[*w] == es[v] + cost[v])
+				next = *w;
+		}
+		v = next;
+	}
+
+	out->levelWidth.clear();
+	for (int u = 0; u < n; u++)
+	{
+		if (level[u] >= (int)out->levelWidth.size())
+			out->levelWidth.resize(level[u] + 1, 0);
+		out->levelWidth[level[u]]++;
+	}
+	out->maxConcurrency = out->levelWidth.empty() ? 0 : *std::max_element(out->levelWidth.begin(), out->levelWidth.end());
+	out->avgConcurrency = out->length > 0 ? (double)out->totalCost / out->length : 0.0;
+	return true;
+}
+
+bool strongly_connected(const CsrGraph& graph, StronglyConnected* out)
+{
+	const int n = graph.m_numVertices;
+	std::vector<int> index(n, -1);		// DFS discovery order
+	std::vector<int> low(n, 0);
+	std::vector<char> onStack(n, 0);
+	std::vector<int> stack;				// Tarjan's component stack
+	std::vector<std::pair<int, int>> calls;	// DFS frames: vertex, next out-edge offset
+
+	std::vector<int>& comp = out->component;
+	comp.assign(n, -1);
+	int numComponents = 0;
+	int counter = 0;
+
+	for (int root = 0; root < n; root++)
+	{
+		if (index[root] >= 0)
+			continue;
+
+		calls.push_back(std::make_pair(root, graph.m_offsets[root]));
+		index[root] = low[root] = counter++;
+		stack.push_back(root);
+		onStack[root] = 1;
+
+		while (!calls.empty())
+		{
+			const int v = calls.back().first;
+			int& e = calls.back().second;
+			if (e < graph.m_offsets[v + 1])
+			{
+				const int w = graph.m_targets[e++];
+				if (index[w] < 0)
+				{
+					index[w] = low[w] = counter++;
+					stack.push_back(w);
+					onStack[w] = 1;
+					calls.push_back(std::make_pair(w, graph.m_offsets[w]));
+				}
+				else if (onStack[w])
+					low[v] = std::min(low[v], index[w]);
+				continue;
+			}
+
+			// v is finished: pop its component if it is the root, then return to the caller
+			if (low[v] == index[v])
+			{
+				int w;
+				do
+				{
+					w = stack.back();
+					stack.pop_back();
+					onStack[w] = 0;
+					comp[w] = numComponents;
+				} while (w != v);
+				numComponents++;
+			}
+			calls.pop_back();
+			if (!calls.empty())
+			{
+				const int parent = calls.back().first;
+				low[parent] = std::min(low[parent], low[v]);
+			}
+		}
+	}
+
+	// Tarjan completes sinks first; flip the numbering so edges go low to high
+	for (int v = 0; v < n; v++)
+		comp[v] = numComponents - 1 - comp[v];
+	out->numComponents = numComponents;
+
+	std::vector<int> size(numComponents, 0);
+	for (int v = 0; v < n; v++)
+		size[comp[v]]++;
+
+	// witness: inside a component of two or more, every vertex has an edge that stays
+	// in it, so walking such edges must come back to a vertex already on the walk
+	out->cycle.clear();
+	for (int v = 0; v < n && out->cycle.empty(); v++)
+	{
+		for (const int* w = graph.OutBegin(v); w != graph.OutEnd(v); w++)
+		{
+			if (*w == v)
+			{
+				out->cycle.assign(2, v);
+				break;
+			}
+		}
+	}
+	for (int start = 0; start < n && out->cycle.empty(); start++)
+	{
+		if (size[comp[start]] < 2)
+			continue;
+
+		std::vector<int> position(n, -1);	// only reached once, for the first such component
+		std::vector<int> walk;
+		int v = start;
+		while (position[v] < 0)
+		{
+			position[v] = (int)walk.size();
+			walk.push_back(v);
+			const int* w = graph.OutBegin(v);
+			while (comp[*w] != comp[v])
+				w++;
+			v = *w;
+		}
+		out->cycle.assign(walk.begin() + position[v], walk.end());
+		out->cycle.push_back(v);
+	}
+
+	// condensed edges without sorting: visit the vertices grouped by component and
+	// drop repeats with a per-target mark of the last source component seen
+	std::vector<int> first(numComponents + 1, 0);
+	for (int c = 0; c < numComponents; c++)
+		first[c + 1] = first[c] + size[c];
+	std::vector<int> byComponent(n);
+	std::vector<int> next(first.begin(), first.end() - 1);
+	for (int v = 0; v < n; v++)
+		byComponent[next[comp[v]]++] = v;
+
+	std::vector<int> lastSource(numComponents, -1);
+	std::vector<std::pair<int, int>> condensedEdges;
+	for (int c = 0; c < numComponents; c++)
+	{
+		for (int k = first[c]; k < first[c + 1]; k++)
+		{
+			const int v = byComponent[k];
+			for (const int* w = graph.OutBegin(v); w != graph.OutEnd(v); w++)
+			{
+				const int target = comp[*w];
+				if (target != c && lastSource[target] != c)
+				{
+					lastSource[target] = c;
+					condensedEdges.push_back(std::make_pair(c, target));
+				}
+			}
+		}
+	}
+	out->condensed.Build(numComponents, condensedEdges);
+
+	return !out->cycle.empty();
+}
+
 void test_top_sort()
 {
 	int num_vertices = 5;
@@ -158,4 +430,134 @@ void test_top_sort()
 	}
 
 	edges.Release();
-}
\ No newline at end of file
+
+	std::vector<std::pair<int, int>> edgeList = { { 0, 1 }, { 0, 2 }, { 1, 3 }, { 2, 3 }, { 3, 4 } };
+	CsrGraph graph;
+	graph.Build(num_vertices, edgeList);
+	std::vector<int> order;
+	ret = csr_top_sort(graph, &order);
+	printf("\ncsr ret: %d {", ret);
+	for (size_t i = 0; i < order.size(); i++)
+		printf(" %d", order[i]);
+	printf(" }\n");
+
+	edgeList.push_back(std::make_pair(4, 2));
+	graph.Build(num_vertices, edgeList);
+	ret = csr_top_sort(graph, &order);
+	printf("csr with 4 -> 2: ret %d, %d of %d sorted\n", ret, (int)order.size(), num_vertices);
+
+	// job costs for the diamond 0 -> {1, 2} -> 3 -> 4
+	edgeList.pop_back();
+	graph.Build(num_vertices, edgeList);
+	std::vector<long long> cost = { 2, 5, 3, 1, 4 };
+	CriticalPath cp;
+	critical_path(graph, cost, &cp);
+	printf("critical path %lld of %lld total, chain:", cp.length, cp.totalCost);
+	for (size_t i = 0; i < cp.chain.size(); i++)
+		printf(" %d", cp.chain[i]);
+	printf("\n");
+	for (int v = 0; v < num_vertices; v++)
+		printf("  %d: earliest %lld, latest %lld, slack %lld\n", v, cp.earliestStart[v], cp.latestStart[v], cp.slack[v]);
+	printf("levels:");
+	for (size_t l = 0; l < cp.levelWidth.size(); l++)
+		printf(" %d", cp.levelWidth[l]);
+	printf(", max concurrency %d, average %.2f\n", cp.maxConcurrency, cp.avgConcurrency);
+
+	// 1 -> 3 -> 4 -> 1 closes a cycle; the rest stays acyclic
+	edgeList.push_back(std::make_pair(4, 1));
+	graph.Build(num_vertices, edgeList);
+	StronglyConnected scc;
+	ret = strongly_connected(graph, &scc);
+	printf("scc: cycle %d, %d components:", ret, scc.numComponents);
+	for (int v = 0; v < num_vertices; v++)
+		printf(" %d->%d", v, scc.component[v]);
+	printf("\ncycle:");
+	for (size_t i = 0; i < scc.cycle.size(); i++)
+		printf(" %d", scc.cycle[i]);
+	printf("\ncondensed edges:");
+	for (int c = 0; c < scc.numComponents; c++)
+	{
+		for (const int* w = scc.condensed.OutBegin(c); w != scc.condensed.OutEnd(c); w++)
+			printf(" %d->%d", c, *w);
+	}
+	printf("\n");
+}
+
+static BenchBody bench_top_sort(int n, std::mt19937& rng)
+{
+	std::vector<std::pair<int, int>> edges = random_dag_edges(n, 4 * n, rng);
+	return [n, edges]()
+	{
+		// top_sort consumes the edge counts, so the matrix is rebuilt on every run
+		EdgeMatrix matrix;
+		matrix.Allocate(n, n);
+		for (size_t i = 0; i < edges.size(); i++)
+			matrix.Set(edges[i].first, edges[i].second, 1);
+
+		std::vector<int> L(n);
+		int numL = 0;
+		bool cycle = top_sort(n, &matrix, L.data(), &numL);
+		bench_consume(numL + (cycle ? 1 : 0));
+		matrix.Release();
+	};
+}
+
+static BenchBody bench_csr_build(int n, std::mt19937& rng)
+{
+	std::vector<std::pair<int, int>> edges = random_dag_edges(n, 4 * n, rng);
+	return [n, edges]()
+	{
+		CsrGraph graph;
+		graph.Build(n, edges);
+		bench_consume(graph.NumEdges());
+	};
+}
+
+static BenchBody bench_top_sort_csr(int n, std::mt19937& rng)
+{
+	CsrGraph graph;
+	graph.Build(n, random_dag_edges(n, 4 * n, rng));
+	return [graph]()
+	{
+		std::vector<int> order;
+		bool cycle = csr_top_sort(graph, &order);
+		bench_consume((long long)order.size() + (cycle ? 1 : 0));
+	};
+}
+
+static BenchBody bench_critical_path(int n, std::mt19937& rng)
+{
+	CsrGraph graph;
+	graph.Build(n, random_dag_edges(n, 4 * n, rng));
+	std::vector<int> costs = random_ints(n, 1, 1000, rng);
+	std::vector<long long> cost(costs.begin(), costs.end());
+	return [graph, cost]()
+	{
+		CriticalPath cp;
+		critical_path(graph, cost, &cp);
+		bench_consume(cp.length);
+	};
+}
+
+// a random DAG plus a few back edges, so there are cycles to find and condense
+static BenchBody bench_strongly_connected(int n, std::mt19937& rng)
+{
+	std::vector<std::pair<int, int>> edges = random_dag_edges(n, 4 * n, rng);
+	for (int i = 0; i < n / 1000 + 1; i++)
+		edges.push_back(std::make_pair(edges[i].second, edges[i].first));
+
+	CsrGraph graph;
+	graph.Build(n, edges);
+	return [graph]()
+	{
+		StronglyConnected scc;
+		strongly_connected(graph, &scc);
+		bench_consume(scc.numComponents);
+	};
+}
+
+REGISTER_BENCHMARK(top_sort, bench_top_sort, 200, 2000);
+REGISTER_BENCHMARK(strongly_connected, bench_strongly_connected, 1000000, 20000000);
+REGISTER_BENCHMARK(critical_path, bench_critical_path, 1000000, 20000000);
+REGISTER_BENCHMARK(csr_build, bench_csr_build, 1000000, 20000000);
+REGISTER_BENCHMARK(top_sort_csr, bench_top_sort_csr, 1000000, 20000000);
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+
+// Compressed sparse row graph: the out-edges of v are
+// m_targets[m_offsets[v], m_offsets[v + 1]), so a traversal touches each vertex and
+// edge once in memory order. m_inDegree is kept from the build; algorithms that
+// consume in-degrees work on a copy, so the graph can be sorted again.
+struct CsrGraph
+{
+	int m_numVertices = 0;
+	std::vector<int> m_offsets;		// m_numVertices + 1 entries
+	std::vector<int> m_targets;		// one per edge, grouped by source
+	std::vector<int> m_inDegree;
+
+	// counting sort of the edges by source, O(V + E); duplicate edges are kept
+	void Build(int numVertices, const std::vector<std::pair<int, int>>& edges);
+
+	int NumEdges() const { return (int)m_targets.size(); }
+	const int* OutBegin(int v) const { return m_targets.data() + m_offsets[v]; }
+	const int* OutEnd(int v) const { return m_targets.data() + m_offsets[v + 1]; }
+};
+
+// Kahn's algorithm in O(V + E). order gets the vertices in topological order; on a
+// cycle it stops short of the vertices on or behind the cycle and true is
+// returned, like top_sort().
+bool csr_top_sort(const CsrGraph& graph, std::vector<int>* order);
+
+struct CriticalPath
+{
+	long long length = 0;				// cost of the longest path, the best possible makespan
+	long long totalCost = 0;
+	std::vector<long long> earliestStart;
+	std::vector<long long> latestStart;	// latest start that doesn't delay the whole graph
+	std::vector<long long> slack;		// latestStart - earliestStart, 0 on critical vertices
+	std::vector<int> chain;				// one critical path, source to sink
+	std::vector<int> levelWidth;		// vertices per level, level = edges on the longest path from a source
+	int maxConcurrency = 0;				// widest level
+	double avgConcurrency = 0.0;		// totalCost / length, the speedup bound on unlimited cores
+};
+
+// Critical path method on a DAG with per-vertex costs: one forward pass in
+// topological order for the earliest starts and levels, one backward pass for the
+// latest starts, O(V + E). Returns false on a cycle.
+bool critical_path(const CsrGraph& graph, const std::vector<long long>& cost, CriticalPath* out);
+
+struct StronglyConnected
+{
+	int numComponents = 0;
+	std::vector<int> component;		// per vertex; components are numbered in topological order
+	std::vector<int> cycle;			// one cycle, first vertex repeated at the end; empty for a DAG
+	CsrGraph condensed;				// one vertex per component, duplicate edges merged
+};
+
+// Tarjan's strongly connected components with an explicit stack instead of
+// recursion, so path length is only limited by memory; O(V + E). Returns whether
+// the graph has a cycle (a component of two or more vertices, or a self loop).
+bool strongly_connected(const CsrGraph& graph, StronglyConnected* out);
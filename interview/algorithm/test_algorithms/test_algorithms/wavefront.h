@@ -0,0 +1,69 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "parallel.h"
+
+// Fills an nrows x ncols dynamic programming table in parallel. cell(i, j) computes
+// one cell and may read any cell (i', j') with i' <= i and j' <= j, which covers the
+// usual left / upper / diagonal recurrences and also "anything above in the previous
+// column". The table is cut into tileRows x tileCols tiles, filled row-major inside a
+// tile; tiles are handed out along anti-diagonals, and a tile starts once the tiles
+// to its left and above are done (which transitively covers everything up-left of
+// it). Tiles are handed out in diagonal order, so whatever a tile waits on has
+// already been picked up by another worker and the wait always ends.
+template <typename Cell>
+void wavefront_for(int nrows, int ncols, int tileRows, int tileCols, int numThreads, Cell cell)
+{
+	if (nrows <= 0 || ncols <= 0)
+		return;
+	tileRows = std::max(1, tileRows);
+	tileCols = std::max(1, tileCols);
+
+	const int rowTiles = (nrows + tileRows - 1) / tileRows;
+	const int colTiles = (ncols + tileCols - 1) / tileCols;
+	const int numTiles = rowTiles * colTiles;
+
+	std::vector<std::pair<int, int>> order;
+	order.reserve(numTiles);
+	for (int d = 0; d < rowTiles + colTiles - 1; d++)
+	{
+		for (int ti = std::max(0, d - colTiles + 1); ti <= std::min(d, rowTiles - 1); ti++)
+			order.push_back(std::make_pair(ti, d - ti));
+	}
+
+	std::unique_ptr<std::atomic<bool>[]> done(new std::atomic<bool>[numTiles]);
+	for (int i = 0; i < numTiles; i++)
+		done[i].store(false, std::memory_order_relaxed);
+
+	auto wait_for = [&](int ti, int tj)
+	{
+		if (ti < 0 || tj < 0)
+			return;
+		while (!done[ti * colTiles + tj].load(std::memory_order_acquire))
+			std::this_thread::yield();
+	};
+
+	parallel_for(numTiles, numThreads, [&](int task, int)
+	{
+		const int ti = order[task].first;
+		const int tj = order[task].second;
+		wait_for(ti - 1, tj);
+		wait_for(ti, tj - 1);
+
+		const int i1 = std::min((ti + 1) * tileRows, nrows);
+		const int j1 = std::min((tj + 1) * tileCols, ncols);
+		for (int i = ti * tileRows; i < i1; i++)
+		{
+			for (int j = tj * tileCols; j < j1; j++)
+				cell(i, j);
+		}
+
+		done[ti * colTiles + tj].store(true, std::memory_order_release);
+	});
+}
@@ -7,12 +7,16 @@
 //#include <cuda.h>
 //#include <cuda_runtime.h>
 #include <string>
+#include <vector>
 
 #include "hw1.h"
 
 cv::Mat imageRGBA;
 cv::Mat imageGrey;
 
+//keeps every loaded image alive so several RawImages can be used at once
+static std::vector<cv::Mat> loadedImages;
+
 //return types are void since any internal error will be handled by quitting
 //no point in returning error codes...
 //returns a pointer to an RGBA version of the input image
@@ -29,7 +33,10 @@ void loadImage(const std::string &filename, RawImage* outImage) {
     exit(1);
   }
 
+  //each call converts into a fresh buffer instead of reusing the previous one
+  imageRGBA.release();
   cv::cvtColor(image, imageRGBA, CV_BGR2RGBA);
+  loadedImages.push_back(imageRGBA);
 
   //allocate memory for the output
   imageGrey.create(image.rows, image.cols, CV_8UC1);
@@ -55,6 +62,16 @@ void postProcess(const std::string& output_file, int numRows, int numCols, unsig
   cv::imwrite(output_file.c_str(), output);
 }
 
+void postProcessRGBA(const std::string& output_file, int numRows, int numCols, unsigned char* data_ptr)
+{
+  cv::Mat output(numRows, numCols, CV_8UC4, (void*)data_ptr);
+  cv::Mat outputBGR;
+  cv::cvtColor(output, outputBGR, CV_RGBA2BGR);
+
+  //output the image
+  cv::imwrite(output_file.c_str(), outputBGR);
+}
+
 void cleanup()
 {
   //cleanup
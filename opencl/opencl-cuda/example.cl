@@ -37,3 +37,184 @@ grayscale(__global uchar4* input,
         output[ind] = (uchar)(.299f * R + .587f * G + .114f * B);
     }
 }
+
+
+// Region-of-interest variant of grayscale. The host launches it with a global
+// offset at the ROI origin, so global ids are frame coordinates, while input and
+// output only hold the roiRows x roiCols rectangle.
+__kernel void
+grayscale_roi(__global uchar4* input,
+              __global uchar* output,
+              const unsigned int roiRows,
+              const unsigned int roiCols)
+{
+    int xind = get_global_id(0) - get_global_offset(0);
+    int yind = get_global_id(1) - get_global_offset(1);
+    if (xind < roiRows && yind < roiCols)
+    {
+        int ind = xind * roiCols + yind;
+        uchar R = input[ind].x;
+        uchar G = input[ind].y;
+        uchar B = input[ind].z;
+        output[ind] = (uchar)(.299f * R + .587f * G + .114f * B);
+    }
+}
+
+// Batched grayscale over many images packed back to back in one buffer.
+// descs[i] is (first pixel, numRows, numCols, unused) of image i. Row i of the
+// NDRange walks image i with a stride loop, so images of any size share one launch.
+__kernel void
+grayscale_batch(__global const uchar4* input,
+                __global uchar* output,
+                __global const uint4* descs,
+                const unsigned int numImages)
+{
+    int image = get_global_id(1);
+    if (image < numImages)
+    {
+        uint4 desc = descs[image];
+        uint numPixels = desc.y * desc.z;
+        for (uint i = get_global_id(0); i < numPixels; i += get_global_size(0))
+        {
+            uint ind = desc.x + i;
+            uchar R = input[ind].x;
+            uchar G = input[ind].y;
+            uchar B = input[ind].z;
+            output[ind] = (uchar)(.299f * R + .587f * G + .114f * B);
+        }
+    }
+}
+
+// Image-object variants. Images are RGBA / CL_UNORM_INT8 with the column index
+// as the x coordinate, so read_imagef() returns channels already scaled to [0, 1].
+
+__constant sampler_t nearestClampSampler = CLK_NORMALIZED_COORDS_FALSE |
+                                           CLK_ADDRESS_CLAMP_TO_EDGE |
+                                           CLK_FILTER_NEAREST;
+
+__kernel void
+grayscale_image(__read_only image2d_t input,
+                __global uchar* output,
+                const unsigned int numRows,
+                const unsigned int numCols)
+{
+    int xind = get_global_id(0);
+    int yind = get_global_id(1);
+    if (xind < numRows && yind < numCols)
+    {
+        float4 rgba = read_imagef(input, nearestClampSampler, (int2)(yind, xind)) * 255.0f;
+        output[xind * numCols + yind] = (uchar)(.299f * rgba.x + .587f * rgba.y + .114f * rgba.z);
+    }
+}
+
+// Bilinear resize with clamp-to-edge, pixel centers at +0.5 (same convention
+// as CLK_FILTER_LINEAR, so resize and resize_image agree up to rounding).
+__kernel void
+resize(__global const uchar4* input,
+       __global uchar4* output,
+       const unsigned int srcRows,
+       const unsigned int srcCols,
+       const unsigned int dstRows,
+       const unsigned int dstCols)
+{
+    int xind = get_global_id(0);
+    int yind = get_global_id(1);
+    if (xind < dstRows && yind < dstCols)
+    {
+        float sr = (xind + 0.5f) * srcRows / dstRows - 0.5f;
+        float sc = (yind + 0.5f) * srcCols / dstCols - 0.5f;
+        float r = floor(sr);
+        float c = floor(sc);
+        float fr = sr - r;
+        float fc = sc - c;
+
+        int r0 = clamp((int)r, 0, (int)srcRows - 1);
+        int r1 = clamp((int)r + 1, 0, (int)srcRows - 1);
+        int c0 = clamp((int)c, 0, (int)srcCols - 1);
+        int c1 = clamp((int)c + 1, 0, (int)srcCols - 1);
+
+        float4 top = mix(convert_float4(input[r0 * srcCols + c0]), convert_float4(input[r0 * srcCols + c1]), fc);
+        float4 bottom = mix(convert_float4(input[r1 * srcCols + c0]), convert_float4(input[r1 * srcCols + c1]), fc);
+        output[xind * dstCols + yind] = convert_uchar4_sat_rte(mix(top, bottom, fr));
+    }
+}
+
+// sampler is created on the host: normalized coords, clamp-to-edge, linear.
+__kernel void
+resize_image(__read_only image2d_t input,
+             __write_only image2d_t output,
+             sampler_t sampler,
+             const unsigned int dstRows,
+             const unsigned int dstCols)
+{
+    int xind = get_global_id(0);
+    int yind = get_global_id(1);
+    if (xind < dstRows && yind < dstCols)
+    {
+        float2 coord = (float2)((yind + 0.5f) / dstCols, (xind + 0.5f) / dstRows);
+        write_imagef(output, (int2)(yind, xind), read_imagef(input, sampler, coord));
+    }
+}
+
+// 3D LUT color transform. The table holds lutSize^3 float4 entries in [0, 1],
+// red varying fastest: lut[(b * lutSize + g) * lutSize + r]. Alpha is kept.
+__kernel void
+lut3d(__global const uchar4* input,
+      __global uchar4* output,
+      __global const float4* lut,
+      const unsigned int lutSize,
+      const unsigned int numRows,
+      const unsigned int numCols)
+{
+    int xind = get_global_id(0);
+    int yind = get_global_id(1);
+    if (xind < numRows && yind < numCols)
+    {
+        int ind = xind * numCols + yind;
+        uchar4 src = input[ind];
+
+        float3 pos = convert_float3(src.xyz) * ((lutSize - 1) / 255.0f);
+        int3 i0 = min(convert_int3(pos), (int3)((int)lutSize - 2));
+        float3 f = pos - convert_float3(i0);
+
+        int n = lutSize;
+        int base = (i0.z * n + i0.y) * n + i0.x;
+        float4 c00 = mix(lut[base], lut[base + 1], f.x);
+        float4 c01 = mix(lut[base + n], lut[base + n + 1], f.x);
+        float4 c10 = mix(lut[base + n * n], lut[base + n * n + 1], f.x);
+        float4 c11 = mix(lut[base + n * n + n], lut[base + n * n + n + 1], f.x);
+        float4 rgb = mix(mix(c00, c01, f.y), mix(c10, c11, f.y), f.z);
+
+        uchar4 dst = convert_uchar4_sat_rte(rgb * 255.0f);
+        dst.w = src.w;
+        output[ind] = dst;
+    }
+}
+
+// Same transform with the table in a 3D image; the host sampler does the
+// trilinear interpolation (normalized coords, clamp-to-edge, linear).
+__kernel void
+lut3d_image(__read_only image2d_t input,
+            __write_only image2d_t output,
+            __read_only image3d_t lut,
+            sampler_t sampler,
+            const unsigned int lutSize,
+            const unsigned int numRows,
+            const unsigned int numCols)
+{
+    int xind = get_global_id(0);
+    int yind = get_global_id(1);
+    if (xind < numRows && yind < numCols)
+    {
+        float4 src = read_imagef(input, nearestClampSampler, (int2)(yind, xind));
+
+        // map [0, 1] onto the centers of the first and last LUT texels
+        float scale = (lutSize - 1.0f) / lutSize;
+        float offset = 0.5f / lutSize;
+        float4 coord = (float4)(src.xyz * scale + offset, 0.0f);
+
+        float4 dst = read_imagef(lut, sampler, coord);
+        dst.w = src.w;
+        write_imagef(output, (int2)(yind, xind), dst);
+    }
+}
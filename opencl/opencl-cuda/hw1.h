@@ -34,4 +34,7 @@ void loadImage(const std::string &filename, RawImage* outImage);
 
 void postProcess(const std::string& output_file, int numRows, int numCols, unsigned char* data_ptr);
 
+//same as postProcess for a 4 channel RGBA result
+void postProcessRGBA(const std::string& output_file, int numRows, int numCols, unsigned char* data_ptr);
+
 #endif /* hw1_h */
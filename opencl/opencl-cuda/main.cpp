@@ -7,6 +7,11 @@
 //
 
 #include <iostream>
+#include <algorithm>
+#include <vector>
+#include <chrono>
+#include <stdlib.h>
+#include <string.h>
 #include "cuda-struct.h"
 #include "hw1.h"
 
@@ -18,73 +23,597 @@
 #include <opencv2/core/core.hpp>
 #include <opencv2/opencv.hpp>
 
+// Which memory objects the kernels read from: plain __global buffers, image2d_t
+// objects with samplers, or both (runs each and compares them).
+enum MemPath
+{
+    MEM_BUFFER = 1,
+    MEM_IMAGE = 2,
+    MEM_BOTH = MEM_BUFFER | MEM_IMAGE,
+};
+
+enum Operation
+{
+    OP_GRAYSCALE,
+    OP_RESIZE,
+    OP_LUT,
+};
+
+static const char* kBufferKernels[] = { "grayscale", "resize", "lut3d" };
+static const char* kImageKernels[] = { "grayscale_image", "resize_image", "lut3d_image" };
+
+static const unsigned int kLutSize = 17;
+
+// grayscale_batch launches kBatchLanes work-items per image
+static const size_t kBatchLanes = 256;
+static const size_t kBatchGroupSize = 64;
+
+// Sub-rectangle of the frame, in rows / columns of the RawImage.
+struct Roi
+{
+    unsigned int row = 0;
+    unsigned int col = 0;
+    unsigned int numRows = 0;
+    unsigned int numCols = 0;
+};
+
+struct RunResult
+{
+    std::vector<unsigned char> pixels;  // uchar (grayscale) or uchar4 per output pixel
+    double kernelMs = 0.0;              // average device time of the kernel
+    double totalMs = 0.0;               // average wall time including upload and readback
+};
+
 static char *
 load_program_source(const char *filename)
 {
     struct stat statbuf;
     FILE        *fh;
     char        *source;
-    
+
     fh = fopen(filename, "r");
     if (fh == 0)
         return 0;
-    
+
     stat(filename, &statbuf);
     source = (char *) malloc(statbuf.st_size + 1);
     fread(source, statbuf.st_size, 1, fh);
     source[statbuf.st_size] = '\0';
-    
+
     return source;
 }
 
+static void check_cl(cl_int err, const char* what)
+{
+    if (err != CL_SUCCESS)
+    {
+        printf("Error: Failed to %s! %d\n", what, err);
+        exit(1);
+    }
+}
+
+static double event_elapsed_ms(cl_event event)
+{
+    cl_ulong start = 0;
+    cl_ulong end = 0;
+    clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(start), &start, NULL);
+    clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(end), &end, NULL);
+    return (end - start) * 1e-6;
+}
+
+static void round_global_size(size_t numRows, size_t numCols, const size_t localSize[2], size_t globalSize[2])
+{
+    globalSize[0] = (numRows + localSize[0] - 1) / localSize[0] * localSize[0];
+    globalSize[1] = (numCols + localSize[1] - 1) / localSize[1] * localSize[1];
+}
+
+// A warm grade with a gentle s-curve, laid out as the lut3d kernels expect:
+// red varies fastest, one RGBA float entry per grid point.
+static std::vector<float> make_lut(unsigned int lutSize)
+{
+    std::vector<float> lut(lutSize * lutSize * lutSize * 4);
+    const float step = 1.0f / (lutSize - 1);
+    for (unsigned int b = 0; b < lutSize; b++)
+    {
+        for (unsigned int g = 0; g < lutSize; g++)
+        {
+            for (unsigned int r = 0; r < lutSize; r++)
+            {
+                float rgb[3] = { r * step, g * step, b * step };
+                for (int c = 0; c < 3; c++)
+                    rgb[c] = rgb[c] * rgb[c] * (3.0f - 2.0f * rgb[c]);
+
+                float* entry = &lut[((b * lutSize + g) * lutSize + r) * 4];
+                entry[0] = std::min(1.0f, rgb[0] * 1.06f);
+                entry[1] = rgb[1];
+                entry[2] = rgb[2] * 0.92f;
+                entry[3] = 1.0f;
+            }
+        }
+    }
+    return lut;
+}
+
+// RawImage keeps the OpenCV convention of loadImage(): width is the number of
+// rows and height the number of columns.
+static RunResult run_buffer_path(cl_context context, cl_command_queue commands, cl_kernel kernel,
+                                 Operation op, const RawImage& image, unsigned int dstRows, unsigned int dstCols,
+                                 const std::vector<float>& lut, int iterations)
+{
+    const unsigned int numRows = image.width;
+    const unsigned int numCols = image.height;
+    const size_t numPixels = numRows * numCols;
+    const unsigned int outRows = op == OP_RESIZE ? dstRows : numRows;
+    const unsigned int outCols = op == OP_RESIZE ? dstCols : numCols;
+    const size_t outBytes = (size_t)outRows * outCols * (op == OP_GRAYSCALE ? sizeof(uchar) : sizeof(uchar4));
+
+    cl_int err;
+    cl_mem input = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(uchar4) * numPixels, NULL, &err);
+    check_cl(err, "allocate input buffer");
+    cl_mem output = clCreateBuffer(context, CL_MEM_WRITE_ONLY, outBytes, NULL, &err);
+    check_cl(err, "allocate output buffer");
+    cl_mem lutBuffer = NULL;
+    if (op == OP_LUT)
+    {
+        lutBuffer = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                   sizeof(float) * lut.size(), (void*)lut.data(), &err);
+        check_cl(err, "allocate lut buffer");
+    }
+
+    err = clSetKernelArg(kernel, 0, sizeof(cl_mem), &input);
+    err |= clSetKernelArg(kernel, 1, sizeof(cl_mem), &output);
+    switch (op)
+    {
+        case OP_GRAYSCALE:
+            err |= clSetKernelArg(kernel, 2, sizeof(unsigned int), &numRows);
+            err |= clSetKernelArg(kernel, 3, sizeof(unsigned int), &numCols);
+            break;
+        case OP_RESIZE:
+            err |= clSetKernelArg(kernel, 2, sizeof(unsigned int), &numRows);
+            err |= clSetKernelArg(kernel, 3, sizeof(unsigned int), &numCols);
+            err |= clSetKernelArg(kernel, 4, sizeof(unsigned int), &dstRows);
+            err |= clSetKernelArg(kernel, 5, sizeof(unsigned int), &dstCols);
+            break;
+        case OP_LUT:
+            err |= clSetKernelArg(kernel, 2, sizeof(cl_mem), &lutBuffer);
+            err |= clSetKernelArg(kernel, 3, sizeof(unsigned int), &kLutSize);
+            err |= clSetKernelArg(kernel, 4, sizeof(unsigned int), &numRows);
+            err |= clSetKernelArg(kernel, 5, sizeof(unsigned int), &numCols);
+            break;
+    }
+    check_cl(err, "set kernel arguments");
+
+    size_t localSize[] = {16, 16};
+    size_t globalSize[2];
+    round_global_size(outRows, outCols, localSize, globalSize);
+
+    RunResult result;
+    result.pixels.resize(outBytes);
+    for (int it = 0; it < iterations; it++)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        err = clEnqueueWriteBuffer(commands, input, CL_TRUE, 0, sizeof(uchar4) * numPixels, image.data, 0, NULL, NULL);
+        check_cl(err, "write to source array");
+
+        cl_event event;
+        err = clEnqueueNDRangeKernel(commands, kernel, 2, NULL, globalSize, localSize, 0, NULL, &event);
+        check_cl(err, "execute kernel");
+
+        err = clEnqueueReadBuffer(commands, output, CL_TRUE, 0, outBytes, result.pixels.data(), 0, NULL, NULL);
+        check_cl(err, "read output array");
+
+        auto end = std::chrono::steady_clock::now();
+        result.kernelMs += event_elapsed_ms(event);
+        result.totalMs += std::chrono::duration<double, std::milli>(end - start).count();
+        clReleaseEvent(event);
+    }
+    result.kernelMs /= iterations;
+    result.totalMs /= iterations;
+
+    if (lutBuffer)
+        clReleaseMemObject(lutBuffer);
+    clReleaseMemObject(input);
+    clReleaseMemObject(output);
+    return result;
+}
+
+static RunResult run_image_path(cl_context context, cl_command_queue commands, cl_kernel kernel,
+                                Operation op, const RawImage& image, unsigned int dstRows, unsigned int dstCols,
+                                const std::vector<float>& lut, int iterations)
+{
+    const unsigned int numRows = image.width;
+    const unsigned int numCols = image.height;
+    const unsigned int outRows = op == OP_RESIZE ? dstRows : numRows;
+    const unsigned int outCols = op == OP_RESIZE ? dstCols : numCols;
+    const size_t outBytes = (size_t)outRows * outCols * (op == OP_GRAYSCALE ? sizeof(uchar) : sizeof(uchar4));
+
+    cl_image_format rgbaFormat = { CL_RGBA, CL_UNORM_INT8 };
+    cl_image_desc desc;
+    memset(&desc, 0, sizeof(desc));
+    desc.image_type = CL_MEM_OBJECT_IMAGE2D;
+    desc.image_width = numCols;
+    desc.image_height = numRows;
+
+    cl_int err;
+    cl_mem input = clCreateImage(context, CL_MEM_READ_ONLY, &rgbaFormat, &desc, NULL, &err);
+    check_cl(err, "allocate input image");
+
+    // grayscale writes a plain uchar buffer, the RGBA operations write an image
+    cl_mem output;
+    if (op == OP_GRAYSCALE)
+    {
+        output = clCreateBuffer(context, CL_MEM_WRITE_ONLY, outBytes, NULL, &err);
+    }
+    else
+    {
+        desc.image_width = outCols;
+        desc.image_height = outRows;
+        output = clCreateImage(context, CL_MEM_WRITE_ONLY, &rgbaFormat, &desc, NULL, &err);
+    }
+    check_cl(err, "allocate output");
+
+    cl_sampler sampler = NULL;
+    if (op != OP_GRAYSCALE)
+    {
+        sampler = clCreateSampler(context, CL_TRUE, CL_ADDRESS_CLAMP_TO_EDGE, CL_FILTER_LINEAR, &err);
+        check_cl(err, "create sampler");
+    }
+
+    cl_mem lutImage = NULL;
+    if (op == OP_LUT)
+    {
+        cl_image_format lutFormat = { CL_RGBA, CL_FLOAT };
+        cl_image_desc lutDesc;
+        memset(&lutDesc, 0, sizeof(lutDesc));
+        lutDesc.image_type = CL_MEM_OBJECT_IMAGE3D;
+        lutDesc.image_width = kLutSize;
+        lutDesc.image_height = kLutSize;
+        lutDesc.image_depth = kLutSize;
+        lutImage = clCreateImage(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                 &lutFormat, &lutDesc, (void*)lut.data(), &err);
+        check_cl(err, "allocate lut image");
+    }
+
+    err = clSetKernelArg(kernel, 0, sizeof(cl_mem), &input);
+    err |= clSetKernelArg(kernel, 1, sizeof(cl_mem), &output);
+    switch (op)
+    {
+        case OP_GRAYSCALE:
+            err |= clSetKernelArg(kernel, 2, sizeof(unsigned int), &numRows);
+            err |= clSetKernelArg(kernel, 3, sizeof(unsigned int), &numCols);
+            break;
+        case OP_RESIZE:
+            err |= clSetKernelArg(kernel, 2, sizeof(cl_sampler), &sampler);
+            err |= clSetKernelArg(kernel, 3, sizeof(unsigned int), &dstRows);
+            err |= clSetKernelArg(kernel, 4, sizeof(unsigned int), &dstCols);
+            break;
+        case OP_LUT:
+            err |= clSetKernelArg(kernel, 2, sizeof(cl_mem), &lutImage);
+            err |= clSetKernelArg(kernel, 3, sizeof(cl_sampler), &sampler);
+            err |= clSetKernelArg(kernel, 4, sizeof(unsigned int), &kLutSize);
+            err |= clSetKernelArg(kernel, 5, sizeof(unsigned int), &numRows);
+            err |= clSetKernelArg(kernel, 6, sizeof(unsigned int), &numCols);
+            break;
+    }
+    check_cl(err, "set kernel arguments");
+
+    size_t localSize[] = {16, 16};
+    size_t globalSize[2];
+    round_global_size(outRows, outCols, localSize, globalSize);
+
+    const size_t origin[3] = {0, 0, 0};
+    const size_t inRegion[3] = {numCols, numRows, 1};
+    const size_t outRegion[3] = {outCols, outRows, 1};
+
+    RunResult result;
+    result.pixels.resize(outBytes);
+    for (int it = 0; it < iterations; it++)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        err = clEnqueueWriteImage(commands, input, CL_TRUE, origin, inRegion, 0, 0, image.data, 0, NULL, NULL);
+        check_cl(err, "write to source image");
+
+        cl_event event;
+        err = clEnqueueNDRangeKernel(commands, kernel, 2, NULL, globalSize, localSize, 0, NULL, &event);
+        check_cl(err, "execute kernel");
+
+        if (op == OP_GRAYSCALE)
+            err = clEnqueueReadBuffer(commands, output, CL_TRUE, 0, outBytes, result.pixels.data(), 0, NULL, NULL);
+        else
+            err = clEnqueueReadImage(commands, output, CL_TRUE, origin, outRegion, 0, 0, result.pixels.data(), 0, NULL, NULL);
+        check_cl(err, "read output");
+
+        auto end = std::chrono::steady_clock::now();
+        result.kernelMs += event_elapsed_ms(event);
+        result.totalMs += std::chrono::duration<double, std::milli>(end - start).count();
+        clReleaseEvent(event);
+    }
+    result.kernelMs /= iterations;
+    result.totalMs /= iterations;
+
+    if (lutImage)
+        clReleaseMemObject(lutImage);
+    if (sampler)
+        clReleaseSampler(sampler);
+    clReleaseMemObject(input);
+    clReleaseMemObject(output);
+    return result;
+}
+
+// grayscale over a sub-rectangle only: the ROI is uploaded and read back with
+// rectangular transfers and the NDRange covers just the ROI. The result is a
+// full-frame grey image that is black outside the ROI.
+static RunResult run_roi_path(cl_context context, cl_command_queue commands, cl_kernel kernel,
+                              const RawImage& image, const Roi& roi, int iterations)
+{
+    const size_t numCols = image.height;
+    const size_t roiPixels = (size_t)roi.numRows * roi.numCols;
+
+    cl_int err;
+    cl_mem input = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(uchar4) * roiPixels, NULL, &err);
+    check_cl(err, "allocate input buffer");
+    cl_mem output = clCreateBuffer(context, CL_MEM_WRITE_ONLY, sizeof(uchar) * roiPixels, NULL, &err);
+    check_cl(err, "allocate output buffer");
+
+    err = clSetKernelArg(kernel, 0, sizeof(cl_mem), &input);
+    err |= clSetKernelArg(kernel, 1, sizeof(cl_mem), &output);
+    err |= clSetKernelArg(kernel, 2, sizeof(unsigned int), &roi.numRows);
+    err |= clSetKernelArg(kernel, 3, sizeof(unsigned int), &roi.numCols);
+    check_cl(err, "set kernel arguments");
+
+    size_t localSize[] = {16, 16};
+    size_t globalSize[2];
+    round_global_size(roi.numRows, roi.numCols, localSize, globalSize);
+    const size_t globalOffset[] = {roi.row, roi.col};
+
+    // rect origins and regions are {bytes, rows, slices}; device buffers are packed
+    const size_t bufferOrigin[3] = {0, 0, 0};
+    const size_t inHostOrigin[3] = {roi.col * sizeof(uchar4), roi.row, 0};
+    const size_t inRegion[3] = {roi.numCols * sizeof(uchar4), roi.numRows, 1};
+    const size_t outHostOrigin[3] = {roi.col * sizeof(uchar), roi.row, 0};
+    const size_t outRegion[3] = {roi.numCols * sizeof(uchar), roi.numRows, 1};
+
+    RunResult result;
+    result.pixels.assign((size_t)image.width * numCols, 0);
+    for (int it = 0; it < iterations; it++)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        err = clEnqueueWriteBufferRect(commands, input, CL_TRUE, bufferOrigin, inHostOrigin, inRegion,
+                                       roi.numCols * sizeof(uchar4), 0, numCols * sizeof(uchar4), 0,
+                                       image.data, 0, NULL, NULL);
+        check_cl(err, "write roi to source array");
+
+        cl_event event;
+        err = clEnqueueNDRangeKernel(commands, kernel, 2, globalOffset, globalSize, localSize, 0, NULL, &event);
+        check_cl(err, "execute kernel");
+
+        err = clEnqueueReadBufferRect(commands, output, CL_TRUE, bufferOrigin, outHostOrigin, outRegion,
+                                      roi.numCols * sizeof(uchar), 0, numCols * sizeof(uchar), 0,
+                                      result.pixels.data(), 0, NULL, NULL);
+        check_cl(err, "read roi from output array");
+
+        auto end = std::chrono::steady_clock::now();
+        result.kernelMs += event_elapsed_ms(event);
+        result.totalMs += std::chrono::duration<double, std::milli>(end - start).count();
+        clReleaseEvent(event);
+    }
+    result.kernelMs /= iterations;
+    result.totalMs /= iterations;
+
+    clReleaseMemObject(input);
+    clReleaseMemObject(output);
+    return result;
+}
+
+// Converts all images with a single grayscale_batch launch. The images are
+// packed back to back into one device buffer, described by a (first pixel,
+// rows, cols) table, and the grey results are scattered back per image.
+static std::vector<std::vector<uchar> > grayscale_batch(cl_context context, cl_command_queue commands, cl_kernel kernel,
+                                                        const std::vector<RawImage>& images, double* kernelMs)
+{
+    const unsigned int numImages = (unsigned int)images.size();
+
+    // one uint4 per image, matching the kernel's descs argument
+    std::vector<cl_uint> descs(numImages * 4);
+    size_t totalPixels = 0;
+    for (unsigned int i = 0; i < numImages; i++)
+    {
+        descs[i * 4 + 0] = (cl_uint)totalPixels;
+        descs[i * 4 + 1] = images[i].width;
+        descs[i * 4 + 2] = images[i].height;
+        descs[i * 4 + 3] = 0;
+        totalPixels += (size_t)images[i].width * images[i].height;
+    }
+
+    std::vector<uchar4> packed(totalPixels);
+    for (unsigned int i = 0; i < numImages; i++)
+        memcpy(&packed[descs[i * 4]], images[i].data, sizeof(uchar4) * images[i].width * images[i].height);
+
+    cl_int err;
+    cl_mem input = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                  sizeof(uchar4) * totalPixels, packed.data(), &err);
+    check_cl(err, "allocate batch input buffer");
+    cl_mem descBuffer = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                       sizeof(cl_uint) * descs.size(), descs.data(), &err);
+    check_cl(err, "allocate batch descriptor buffer");
+    cl_mem output = clCreateBuffer(context, CL_MEM_WRITE_ONLY, sizeof(uchar) * totalPixels, NULL, &err);
+    check_cl(err, "allocate batch output buffer");
+
+    err = clSetKernelArg(kernel, 0, sizeof(cl_mem), &input);
+    err |= clSetKernelArg(kernel, 1, sizeof(cl_mem), &output);
+    err |= clSetKernelArg(kernel, 2, sizeof(cl_mem), &descBuffer);
+    err |= clSetKernelArg(kernel, 3, sizeof(unsigned int), &numImages);
+    check_cl(err, "set kernel arguments");
+
+    size_t localSize[] = {kBatchGroupSize, 1};
+    size_t globalSize[] = {kBatchLanes, numImages};
+    cl_event event;
+    err = clEnqueueNDRangeKernel(commands, kernel, 2, NULL, globalSize, localSize, 0, NULL, &event);
+    check_cl(err, "execute kernel");
+
+    std::vector<uchar> packedGrey(totalPixels);
+    err = clEnqueueReadBuffer(commands, output, CL_TRUE, 0, sizeof(uchar) * totalPixels, packedGrey.data(), 0, NULL, NULL);
+    check_cl(err, "read batch output array");
+
+    *kernelMs = event_elapsed_ms(event);
+    clReleaseEvent(event);
+
+    std::vector<std::vector<uchar> > results(numImages);
+    for (unsigned int i = 0; i < numImages; i++)
+    {
+        std::vector<uchar>::const_iterator first = packedGrey.begin() + descs[i * 4];
+        results[i].assign(first, first + (size_t)images[i].width * images[i].height);
+    }
+
+    clReleaseMemObject(input);
+    clReleaseMemObject(descBuffer);
+    clReleaseMemObject(output);
+    return results;
+}
+
 int main(int argc, const char * argv[]) {
-    
+
+    // pull out --options first so the positional arguments below keep their meaning
+    MemPath memPath = MEM_BUFFER;
+    Operation op = OP_GRAYSCALE;
+    unsigned int dstRows = 0;
+    unsigned int dstCols = 0;
+    int iterations = 1;
+    bool useRoi = false;
+    Roi roi;
+    bool batch = false;
+    std::vector<const char*> args(argv, argv + 1);
+    for (int i = 1; i < argc; i++)
+    {
+        const char* arg = argv[i];
+        if (strcmp(arg, "--mem=buffer") == 0)
+            memPath = MEM_BUFFER;
+        else if (strcmp(arg, "--mem=image") == 0)
+            memPath = MEM_IMAGE;
+        else if (strcmp(arg, "--mem=both") == 0)
+            memPath = MEM_BOTH;
+        else if (strcmp(arg, "--op=grayscale") == 0)
+            op = OP_GRAYSCALE;
+        else if (strcmp(arg, "--op=resize") == 0)
+            op = OP_RESIZE;
+        else if (strcmp(arg, "--op=lut") == 0)
+            op = OP_LUT;
+        else if (strncmp(arg, "--size=", 7) == 0)
+            sscanf(arg + 7, "%ux%u", &dstCols, &dstRows);
+        else if (strncmp(arg, "--roi=", 6) == 0)
+        {
+            if (sscanf(arg + 6, "%u,%u,%u,%u", &roi.col, &roi.row, &roi.numCols, &roi.numRows) != 4)
+            {
+                std::cerr << "Bad ROI " << arg << ", expected --roi=x,y,w,h" << std::endl;
+                exit(1);
+            }
+            useRoi = true;
+        }
+        else if (strcmp(arg, "--batch") == 0)
+            batch = true;
+        else if (strncmp(arg, "--iterations=", 13) == 0)
+            iterations = std::max(1, atoi(arg + 13));
+        else
+            args.push_back(arg);
+    }
+    argc = (int)args.size();
+    argv = args.data();
+
     std::string input_file;
     std::string output_file;
     std::string reference_file;
     double perPixelError = 0.0;
     double globalError   = 0.0;
     bool useEpsCheck = false;
-    switch (argc)
+    std::vector<std::string> batch_files;
+    if (batch)
     {
-        case 2:
-            input_file = std::string(argv[1]);
-            output_file = "HW1_output.png";
-            reference_file = "HW1_reference.png";
-            break;
-        case 3:
-            input_file  = std::string(argv[1]);
-            output_file = std::string(argv[2]);
-            reference_file = "HW1_reference.png";
-            break;
-        case 4:
-            input_file  = std::string(argv[1]);
-            output_file = std::string(argv[2]);
-            reference_file = std::string(argv[3]);
-            break;
-        case 6:
-            useEpsCheck=true;
-            input_file  = std::string(argv[1]);
-            output_file = std::string(argv[2]);
-            reference_file = std::string(argv[3]);
-            perPixelError = atof(argv[4]);
-            globalError   = atof(argv[5]);
-            break;
-        default:
-            std::cerr << "Usage: ./HW1 input_file [output_filename] [reference_filename] [perPixelError] [globalError]" << std::endl;
+        if (argc < 2 || useRoi || op != OP_GRAYSCALE || memPath != MEM_BUFFER)
+        {
+            std::cerr << "Usage: ./HW1 --batch [--iterations=N] input_file..." << std::endl;
             exit(1);
+        }
+        batch_files.assign(argv + 1, argv + argc);
+    }
+    else
+    {
+        switch (argc)
+        {
+            case 2:
+                input_file = std::string(argv[1]);
+                output_file = "HW1_output.png";
+                reference_file = "HW1_reference.png";
+                break;
+            case 3:
+                input_file  = std::string(argv[1]);
+                output_file = std::string(argv[2]);
+                reference_file = "HW1_reference.png";
+                break;
+            case 4:
+                input_file  = std::string(argv[1]);
+                output_file = std::string(argv[2]);
+                reference_file = std::string(argv[3]);
+                break;
+            case 6:
+                useEpsCheck=true;
+                input_file  = std::string(argv[1]);
+                output_file = std::string(argv[2]);
+                reference_file = std::string(argv[3]);
+                perPixelError = atof(argv[4]);
+                globalError   = atof(argv[5]);
+                break;
+            default:
+                std::cerr << "Usage: ./HW1 [--op=grayscale|resize|lut] [--mem=buffer|image|both] [--size=WxH] [--roi=x,y,w,h] [--iterations=N]" << std::endl;
+                std::cerr << "             input_file [output_filename] [reference_filename] [perPixelError] [globalError]" << std::endl;
+                std::cerr << "       ./HW1 --batch [--iterations=N] input_file..." << std::endl;
+                exit(1);
+        }
     }
-    
+
     //load the image and give us our input and output pointers
     RawImage rawImage;
-    loadImage(input_file, &rawImage);
-    
+    std::vector<RawImage> batchImages(batch_files.size());
+    if (batch)
+    {
+        for (size_t i = 0; i < batch_files.size(); i++)
+            loadImage(batch_files[i], &batchImages[i]);
+    }
+    else
+    {
+        loadImage(input_file, &rawImage);
+    }
+
+    if (useRoi)
+    {
+        if (op != OP_GRAYSCALE || memPath != MEM_BUFFER)
+        {
+            std::cerr << "--roi is only supported with --op=grayscale --mem=buffer" << std::endl;
+            exit(1);
+        }
+        if (roi.numRows == 0 || roi.numCols == 0 ||
+            roi.row > (unsigned int)rawImage.width || roi.numRows > (unsigned int)rawImage.width - roi.row ||
+            roi.col > (unsigned int)rawImage.height || roi.numCols > (unsigned int)rawImage.height - roi.col)
+        {
+            std::cerr << "ROI is empty or outside of the " << rawImage.height << "x" << rawImage.width << " image" << std::endl;
+            exit(1);
+        }
+    }
+
+    // resize defaults to half size in each direction
+    if (op == OP_RESIZE && (dstRows == 0 || dstCols == 0))
+    {
+        dstRows = std::max(1, rawImage.width / 2);
+        dstCols = std::max(1, rawImage.height / 2);
+    }
+
     cl_device_id device_id;             // compute device id
     cl_context context;                 // compute context
     cl_command_queue commands;          // compute command queue
     cl_program program;                 // compute program
-    cl_kernel kernel;                   // compute kernel
-    
+
     // Connect to a compute device
     int gpu = 1;
     int err = clGetDeviceIDs(NULL, gpu ? CL_DEVICE_TYPE_GPU : CL_DEVICE_TYPE_CPU, 1, &device_id, NULL);
@@ -94,6 +623,17 @@ int main(int argc, const char * argv[]) {
         return EXIT_FAILURE;
     }
 
+    if (memPath & MEM_IMAGE)
+    {
+        cl_bool imageSupport = CL_FALSE;
+        clGetDeviceInfo(device_id, CL_DEVICE_IMAGE_SUPPORT, sizeof(imageSupport), &imageSupport, NULL);
+        if (!imageSupport)
+        {
+            printf("Error: Device has no image support, use --mem=buffer!\n");
+            return EXIT_FAILURE;
+        }
+    }
+
     // Create a compute context
     context = clCreateContext(0, 1, &device_id, NULL, NULL, &err);
     if (!context)
@@ -101,15 +641,15 @@ int main(int argc, const char * argv[]) {
         printf("Error: Failed to create a compute context!\n");
         return EXIT_FAILURE;
     }
-    
-    // Create a command commands
-    commands = clCreateCommandQueue(context, device_id, 0, &err);
+
+    // Create a command commands, with profiling so kernels can be timed
+    commands = clCreateCommandQueue(context, device_id, CL_QUEUE_PROFILING_ENABLE, &err);
     if (!commands)
     {
         printf("Error: Failed to create a command commands!\n");
         return EXIT_FAILURE;
     }
-    
+
     const char* filename = "example.cl";
     // Load the compute program from disk into a cstring buffer
     char *source = load_program_source(filename);
@@ -118,7 +658,7 @@ int main(int argc, const char * argv[]) {
         printf("Error: Failed to load compute program from file!\n");
         return EXIT_FAILURE;
     }
-    
+
     // Create the compute program from the source buffer
     //
     program = clCreateProgramWithSource(context, 1, (const char **) & source, NULL, &err);
@@ -127,106 +667,126 @@ int main(int argc, const char * argv[]) {
         printf("Error: Failed to create compute program!\n");
         return EXIT_FAILURE;
     }
-    
+
     // Build the program executable
     err = clBuildProgram(program, 0, NULL, NULL, NULL, NULL);
     if (err != CL_SUCCESS)
     {
         size_t len;
         char buffer[2048];
-        
+
         printf("Error: Failed to build program executable!\n");
         clGetProgramBuildInfo(program, device_id, CL_PROGRAM_BUILD_LOG, sizeof(buffer), buffer, &len);
         printf("%s\n", buffer);
         exit(1);
     }
-    
-    // Create the compute kernel in the program we wish to run
-    kernel = clCreateKernel(program, "grayscale", &err);
-    if (!kernel || err != CL_SUCCESS)
+
+    if (batch)
     {
-        printf("Error: Failed to create compute kernel!\n");
-        exit(1);
-    }
-    
-    const size_t numPixels = rawImage.width * rawImage.height;
-    
-    // Create the input and output arrays in device memory for our calculation
-    cl_mem input;                       // device memory used for the input array
-    cl_mem output;                      // device memory used for the output array
-    input = clCreateBuffer(context,  CL_MEM_READ_ONLY,  sizeof(uchar4) * numPixels, NULL, NULL);
-    output = clCreateBuffer(context, CL_MEM_WRITE_ONLY, sizeof(uchar) * numPixels, NULL, NULL);
-    if (!input || !output)
-    {
-        printf("Error: Failed to allocate device memory!\n");
-        exit(1);
+        // Per-image launches of the plain grayscale kernel as the baseline. Both
+        // totals are wall time around whole calls, so buffer creation and release
+        // count on each side, not just the transfers and the kernel.
+        cl_kernel kernel = clCreateKernel(program, "grayscale", &err);
+        check_cl(err, "create compute kernel");
+        double eachKernelMs = 0.0;
+        double eachTotalMs = 0.0;
+        for (int it = 0; it < iterations; it++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < batchImages.size(); i++)
+            {
+                RunResult run = run_buffer_path(context, commands, kernel, OP_GRAYSCALE, batchImages[i], 0, 0, std::vector<float>(), 1);
+                eachKernelMs += run.kernelMs;
+            }
+            auto end = std::chrono::steady_clock::now();
+            eachTotalMs += std::chrono::duration<double, std::milli>(end - start).count();
+        }
+        clReleaseKernel(kernel);
+        printf("%-8s %s x%d: kernel %.3f ms, total %.3f ms\n", "each", "grayscale", (int)batchImages.size(),
+               eachKernelMs / iterations, eachTotalMs / iterations);
+
+        kernel = clCreateKernel(program, "grayscale_batch", &err);
+        check_cl(err, "create compute kernel");
+        std::vector<std::vector<uchar> > results;
+        double batchKernelMs = 0.0;
+        double batchTotalMs = 0.0;
+        for (int it = 0; it < iterations; it++)
+        {
+            double kernelMs = 0.0;
+            auto start = std::chrono::steady_clock::now();
+            results = grayscale_batch(context, commands, kernel, batchImages, &kernelMs);
+            auto end = std::chrono::steady_clock::now();
+            batchKernelMs += kernelMs;
+            batchTotalMs += std::chrono::duration<double, std::milli>(end - start).count();
+        }
+        clReleaseKernel(kernel);
+        printf("%-8s %s x%d: kernel %.3f ms, total %.3f ms\n", "batch", "grayscale_batch", (int)batchImages.size(),
+               batchKernelMs / iterations, batchTotalMs / iterations);
+
+        for (size_t i = 0; i < results.size(); i++)
+        {
+            char name[64];
+            snprintf(name, sizeof(name), "HW1_batch_%d.png", (int)i);
+            postProcess(name, batchImages[i].width, batchImages[i].height, results[i].data());
+        }
+
+        clReleaseProgram(program);
+        clReleaseCommandQueue(commands);
+        clReleaseContext(context);
+        return 0;
     }
-    
-    // Write our data set into the input array in device memory
-    err = clEnqueueWriteBuffer(commands, input, CL_TRUE, 0, sizeof(uchar4) * numPixels, rawImage.data, 0, NULL, NULL);
-    if (err != CL_SUCCESS)
+
+    std::vector<float> lut;
+    if (op == OP_LUT)
+        lut = make_lut(kLutSize);
+
+    RunResult bufferRun;
+    RunResult imageRun;
+    if (useRoi)
     {
-        printf("Error: Failed to write to source array!\n");
-        exit(1);
+        cl_kernel kernel = clCreateKernel(program, "grayscale_roi", &err);
+        check_cl(err, "create compute kernel");
+        bufferRun = run_roi_path(context, commands, kernel, rawImage, roi, iterations);
+        printf("%-8s %s: kernel %.3f ms, total %.3f ms\n", "roi", "grayscale_roi", bufferRun.kernelMs, bufferRun.totalMs);
+        clReleaseKernel(kernel);
     }
-    
-    // Set the arguments to our compute kernel
-    err = 0;
-    err  = clSetKernelArg(kernel, 0, sizeof(cl_mem), &input);
-    err |= clSetKernelArg(kernel, 1, sizeof(cl_mem), &output);
-    err |= clSetKernelArg(kernel, 2, sizeof(unsigned int), &rawImage.width);
-    err |= clSetKernelArg(kernel, 3, sizeof(unsigned int), &rawImage.height);
-    if (err != CL_SUCCESS)
+    else if (memPath & MEM_BUFFER)
     {
-        printf("Error: Failed to set kernel arguments! %d\n", err);
-        exit(1);
+        cl_kernel kernel = clCreateKernel(program, kBufferKernels[op], &err);
+        check_cl(err, "create compute kernel");
+        bufferRun = run_buffer_path(context, commands, kernel, op, rawImage, dstRows, dstCols, lut, iterations);
+        printf("%-8s %s: kernel %.3f ms, total %.3f ms\n", "buffer", kBufferKernels[op], bufferRun.kernelMs, bufferRun.totalMs);
+        clReleaseKernel(kernel);
     }
-    
-    // Get the maximum work group size for executing the kernel on the device
-//    err = clGetKernelWorkGroupInfo(kernel, device_id, CL_KERNEL_WORK_GROUP_SIZE, sizeof(local), &local, NULL);
-//    if (err != CL_SUCCESS)
-//    {
-//        printf("Error: Failed to retrieve kernel work group info! %d\n", err);
-//        exit(1);
-//    }
-    
-    // Execute the kernel over the entire range of our 1d input data set
-    // using the maximum number of work group items for this device
-
-    size_t localSize[] = {16, 16};
-    size_t globalSize[2];
-    globalSize[0] = (rawImage.width + localSize[0] - 1) / localSize[0] * localSize[0];
-    globalSize[1] = (rawImage.height + localSize[1] - 1) / localSize[1] * localSize[1];
-    
-    err = clEnqueueNDRangeKernel(commands, kernel, 2, NULL, globalSize, localSize, 0, NULL, NULL);
-    if (err)
+    if (memPath & MEM_IMAGE)
     {
-        printf("Error: Failed to execute kernel!\n");
-        return EXIT_FAILURE;
+        cl_kernel kernel = clCreateKernel(program, kImageKernels[op], &err);
+        check_cl(err, "create compute kernel");
+        imageRun = run_image_path(context, commands, kernel, op, rawImage, dstRows, dstCols, lut, iterations);
+        printf("%-8s %s: kernel %.3f ms, total %.3f ms\n", "image", kImageKernels[op], imageRun.kernelMs, imageRun.totalMs);
+        clReleaseKernel(kernel);
     }
-    
-    clFinish(commands);
-    
-    // Read back the results from the device to verify the output
-    uchar* results = new uchar[numPixels];
-    err = clEnqueueReadBuffer(commands, output, CL_TRUE, 0, sizeof(uchar) * numPixels, results, 0, NULL, NULL);
-    if (err != CL_SUCCESS)
+    if (memPath == MEM_BOTH)
     {
-        printf("Error: Failed to read output array! %d\n", err);
-        exit(1);
+        // filtering hardware works at reduced precision, so expect small differences
+        int maxDiff = 0;
+        for (size_t i = 0; i < bufferRun.pixels.size(); i++)
+            maxDiff = std::max(maxDiff, std::abs((int)bufferRun.pixels[i] - (int)imageRun.pixels[i]));
+        printf("max abs difference buffer vs image: %d\n", maxDiff);
     }
-    
-    clFinish(commands);
-    
-    postProcess(output_file, rawImage.width, rawImage.height, results);
+
+    RunResult& run = (memPath & MEM_BUFFER) ? bufferRun : imageRun;
+    if (op == OP_GRAYSCALE)
+        postProcess(output_file, rawImage.width, rawImage.height, run.pixels.data());
+    else if (op == OP_RESIZE)
+        postProcessRGBA(output_file, dstRows, dstCols, run.pixels.data());
+    else
+        postProcessRGBA(output_file, rawImage.width, rawImage.height, run.pixels.data());
 
     // Shutdown and cleanup
-    clReleaseMemObject(input);
-    clReleaseMemObject(output);
     clReleaseProgram(program);
-    clReleaseKernel(kernel);
     clReleaseCommandQueue(commands);
     clReleaseContext(context);
-    
+
     return 0;
 }